@@ -1,7 +1,9 @@
 #include "zjson.h"
+#include <iomanip>
 #include <iostream>
 #include <vector>
 #include <set>
+#include <unordered_set>
 
 int main()
 {
@@ -25,6 +27,97 @@ int main()
 	auto setInt{ jArr.toStdSet<std::set<int>>(&json::Value::asInt32) };
 	std::cout << json::Array::fromStdArray(setInt) << std::endl;
 	std::cout << json::Array::fromStdArray(std::vector{"a", "b", "c"}) << std::endl;
+	//json values as keys (structural hash, fields order does not matter):
+	std::unordered_set<json::Object> uniqueObjs{ jObj, jObj2, json::Object{{"feld3", jArr}, {"field2", "val2"}, {"field1", 1}} };
+	std::cout << "Unique objects: " << uniqueObjs.size() << std::endl;
+	//Nested updates sharing everything else with the older copies (snapshots):
+	const auto snapshot = jObj;
+	jObj.setIn({ "feld3", 0 }, 100);
+	std::cout << "Updated: " << json::setOStreamIdent(0) << jObj << ", snapshot: " << snapshot << std::endl;
+	//Binary formats of untrusted input: too deep nesting throws instead of exhausting the stack, (ignored) CBOR tags do not nest
+	std::string cborTags(200000, '\xc6');
+	cborTags += '\x01';
+	std::cout << "Tagged CBOR value: " << json::fromCbor(cborTags).asInt() << std::endl;
+	try
+	{
+		json::fromCbor(std::string(200000, '\x81') + '\x01');
+		std::cout << "Nested CBOR arrays NOT rejected" << std::endl;
+	}
+	catch (const json::Exc& e)
+	{
+		std::cout << "Nested CBOR arrays: " << e.what() << std::endl;
+	}
+
+	//Big values: parsing and output on several threads, the same result as the serial ones
+	json::Array jBig;
+	for (int i = 0; i < 100000; ++i)
+		jBig.push_back(json::Object{ {"i", i}, {"s", "item " + std::to_string(i)} });
+	std::ostringstream ossSerial, ossParallel;
+	ossSerial << jBig;
+	ossParallel << json::setOStreamParallel(4) << jBig;
+	std::cout << "Parallel output is " << (ossSerial.str() == ossParallel.str() ? "the same" : "NOT the same") << std::endl;
+	std::cout << "Parallel parsing is " << (json::parseParallel(ossSerial.str(), 4) == json::strToArray(ossSerial.str()) ? "the same" : "NOT the same") << std::endl;
+	//Canonical (RFC 8785) output and its SHA-256:
+	std::cout << "Canonical: " << json::toCanonicalString(json::Object{ {"b", 1.0}, {"a", json::Array{ "€", 1e21 }} }) << std::endl;
+	std::ostringstream ossSha;
+	for (const auto byte : json::canonicalSha256(json::Array{}))
+		ossSha << std::hex << std::setw(2) << std::setfill('0') << int(byte);
+	std::cout << "SHA-256 of [] is " << (ossSha.str() == "4f53cda18c2baa0c0354bb5f9a3ecbe5ed12ab4d8e11ba873c2f11161202b945" ? "right" : "WRONG") << std::endl;
+	//Untrusted input with limits (no exceptions):
+	json::ParseLimits limits;
+	limits.maxDepth = 2;
+	limits.maxStringLength = 3;
+	std::cout << "Limits: [[[1]]] " << json::tryParse("[[[1]]]", limits).error().what()
+		<< ", [\"abcd\"] " << json::tryParse(R"(["abcd"])", limits).error().what()
+		<< ", [\"\\n\\n\"] " << (json::tryParse(R"(["\n\n"])", limits) ? "ok" : "NOT ok") << std::endl;
+	//Schema validation:
+	const json::Schema schema{ json::strToObject(R"({"type":"object","properties":{"id":{"type":"integer","minimum":1}},"required":["id"]})") };
+	std::string why;
+	std::cout << "Schema: {\"id\":1} is " << (schema.validate(json::Object{ {"id", 1} }) ? "valid" : "NOT valid");
+	std::cout << ", {\"id\":0} is " << (schema.validate(json::Object{ {"id", 0} }, &why) ? "NOT invalid" : "invalid (" + why + ")");
+	std::cout << ", parsed {} is " << (schema.parse("{}", &why) ? "NOT invalid" : "invalid (" + why + ")") << std::endl;
+	//Output template:
+	const json::Template tmpl{ json::Object{ {"status", "ok"}, {"id", "{{id}}"}, {"data", "{{data}}"} } };
+	const auto rendered = tmpl.render({ {"id", 42}, {"data", jArr} });
+	std::cout << "Template: " << rendered << " is " << (json::strToObject(rendered) == json::Object{ {"status", "ok"}, {"id", 42}, {"data", jArr} } ? "the same" : "NOT the same") << std::endl;
+	//Snapshot queried in place:
+	std::ostringstream ossSnap;
+	json::writeSnapshot(jObj, ossSnap);
+	const std::string snapData = ossSnap.str();
+	const auto snap = json::Snapshot::fromMemory(snapData.data(), snapData.size());
+	std::cout << "Snapshot: field2 " << snap.root()["field2"].asString() << ", feld3[0] " << snap.root()["feld3"][size_t{ 0 }].asInt()
+		<< ", copy is " << (snap.root().toValue() == jObj ? "the same" : "NOT the same") << std::endl;
+#if defined(ZJSON_HAS_ZLIB) || defined(ZJSON_HAS_ZSTD)
+	//Compressed streams:
+	std::stringstream compressed;
+	{
+#if defined(ZJSON_HAS_ZSTD)
+		json::CompressedOStream cos{ compressed, json::Compression::Zstd };
+#else
+		json::CompressedOStream cos{ compressed, json::Compression::Gzip };
+#endif
+		cos << jBig;
+		cos.finish();
+	}
+	json::CompressedIStream cis{ compressed };
+	json::Array jBig2;
+	cis >> jBig2;
+	std::cout << "Compressed " << ossSerial.str().size() << " to " << compressed.str().size() << " bytes, decompressed is " << (jBig2 == jBig ? "the same" : "NOT the same") << std::endl;
+#endif
+	//Reading the elements of a big array one by one:
+	std::istringstream issElements{ R"([{"i":1},{"i":2},{"i":3}])" };
+	json::ElementReader reader{ issElements };
+	int64_t sum{ 0 };
+	for (const json::Value& el : reader)
+		sum += el.asObject()["i"].asInt();
+	std::cout << "ElementReader sum: " << sum << std::endl;
+	//Writing without building the values:
+	std::string written;
+	{
+		json::StreamWriter w{ written };
+		w.beginObject().key("ids").beginArray().value(1).value(2).endArray().key("obj").value(jObj2).endObject();
+	}
+	std::cout << "StreamWriter: " << written << " is " << (json::strToObject(written) == json::Object{ {"ids", json::Array{ 1, 2 }}, {"obj", jObj2} } ? "the same" : "NOT the same") << std::endl;
 
 	//Serialization and deserialization in user defined types:
 
@@ -6,15 +6,164 @@
 #endif
 #include "zjson.h"
 #include "jansson.h"
+#if JANSSON_VERSION_HEX < 0x020a00
+ #error "zjson requires jansson 2.10 or newer (json_dumpb)"
+#endif
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cerrno>
+#include <cmath>
+#include <cstddef>
+#include <cstdlib>
+#include <cstdio>
+#include <cstring>
+#include <deque>
+#include <mutex>
+#include <regex>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+#if defined(__has_include)
+ #if __has_include(<charconv>) && (201703L <= __cplusplus || (defined(_MSVC_LANG) && 201703L <= _MSVC_LANG))
+  #include <charconv>//shortest round trip doubles of the canonical output (__cpp_lib_to_chars)
+ #endif
+#endif
+#if defined(ZJSON_HAS_ZLIB)
+ #include <zlib.h>
+#endif
+#if defined(ZJSON_HAS_ZSTD)
+ #include <zstd.h>
+#endif
+#if defined(__AVX2__)
+ #include <immintrin.h>
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && 2 <= _M_IX86_FP)
+ #include <emmintrin.h>
+ #define ZJSON_SSE2
+#elif defined(__ARM_NEON) && (defined(__aarch64__) || defined(_M_ARM64))
+ #include <arm_neon.h>
+ #define ZJSON_NEON
+#endif
+#if defined(_WIN32)
+ #define WIN32_LEAN_AND_MEAN
+ #define NOMINMAX
+ #include <windows.h>
+#else
+ #include <fcntl.h>
+ #include <sys/mman.h>
+ #include <sys/stat.h>
+ #include <unistd.h>
+#endif
+#if defined(_MSC_VER)
+ #pragma warning(disable: 4073)
+ #pragma init_seg(lib)//the jansson allocator hooks (AllocHooksInstaller) before the clients' static Values
+#endif
 
 namespace json //using namespace will not work for the free functions
 {
+	//internal access to the json_t of the values
+	struct ValueRaw
+	{
+		static json_t* get(const Value& v) { return v.m_val; }
+		static Value steal(json_t* v)
+		{//takes over the reference
+			Value ret;
+			ret.m_val = v;
+			return ret;
+		}
+		static json_t* release(Value& v)
+		{//gives up the reference
+			json_t* ret = v.m_val;
+			v.m_val = nullptr;
+			return ret;
+		}
+	};
+
+#if defined(ZJSON_TRACING)
+	namespace
+	{
+		std::atomic<TraceSink*> g_traceSink{ nullptr };
+
+		//Times the operation and reports it on destruction, if a sink is set (only a pointer check otherwise)
+		class TraceScope
+		{
+		public:
+			explicit TraceScope(TraceOp op)
+				: m_sink(g_traceSink.load(std::memory_order_acquire)), m_op(op)
+			{
+				if (m_sink)
+					m_start = std::chrono::steady_clock::now();
+			}
+			~TraceScope()
+			{
+				if (m_sink)
+					m_sink->onEvent({ m_op, uint64_t(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - m_start).count()), m_size, m_ok });
+			}
+			TraceScope(const TraceScope&) = delete;
+			TraceScope& operator=(const TraceScope&) = delete;
+			bool active() const { return nullptr != m_sink; }
+			void done(size_t size)
+			{
+				m_size = size;
+				m_ok = true;
+			}
+
+		private:
+			TraceSink* const m_sink;
+			const TraceOp m_op;
+			std::chrono::steady_clock::time_point m_start;
+			size_t m_size{ 0 };
+			bool m_ok{ false };
+		};
+	}
+
+	void setTraceSink(TraceSink* sink)
+	{
+		g_traceSink.store(sink, std::memory_order_release);
+	}
+ #define ZJSON_TRACE_SCOPE(op) TraceScope traceScope_{ op }
+ #define ZJSON_TRACE_DONE(size) (traceScope_.active() ? traceScope_.done(size) : (void)0)
+#else
+ #define ZJSON_TRACE_SCOPE(op)
+ #define ZJSON_TRACE_DONE(size) (void)sizeof(size)
+#endif
+
+#if defined(ZJSON_INLINE_ACCESSORS)
+ #if 0x020e00 != JANSSON_VERSION_HEX//the private string, array and object layouts can not be checked here
+  #error "ZJSON_INLINE_ACCESSORS: zjson_inline.h mirrors the jansson 2.14 node layout"
+ #endif
+	static_assert(sizeof(detail::Node) == sizeof(json_t) && offsetof(json_t, refcount) == offsetof(detail::Node, refcount), "jansson json_t layout");
+	static_assert(sizeof(json_int_t) == sizeof(long long) && detail::NODE_NULL == int(JSON_NULL) && detail::NODE_INTEGER == int(JSON_INTEGER), "jansson types");
+
+	namespace detail
+	{
+		void deleteNode(json_t* v)
+		{
+			json_delete(v);
+		}
+ #if !defined(__GNUC__)
+		json_t* incRef(json_t* v)
+		{
+			return json_incref(v);
+		}
+		void decRef(json_t* v)
+		{
+			json_decref(v);
+		}
+ #endif
+	}
+
+#endif
 	Value NULL_VALUE()
 	{
 		return json_null();//using the "borrowed reference" constructor. It is fine here since for null json_incref is noop
 	}
 
+#if !defined(ZJSON_INLINE_ACCESSORS)
 	Value::Value(const Value& rhs) : m_val(json_incref(rhs.m_val)) {}
+#endif
 
 	Value::Value(bool v) : m_val(json_boolean(v)) {}
 
@@ -38,12 +187,39 @@ namespace json //using namespace will not work for the free functions
 
 	Value::Value(double v) : m_val(json_real(v)) {}
 
-	Value::Value(const char* v) : m_val(json_string_nocheck(v)) {}
+	namespace
+	{
+		std::atomic<bool> g_validateStrings{ false };
+
+		json_t* checkedString(const char* v)
+		{
+			if (!v)
+				return nullptr;
+			const size_t sz{ strlen(v) };
+			if (g_validateStrings.load(std::memory_order_relaxed) && !isValidUtf8(v, sz))
+				throw Exc("JSON error: Invalid UTF8 string");
+			return json_stringn_nocheck(v, sz);
+		}
+
+		void checkKey(const char* key)
+		{
+			if (g_validateStrings.load(std::memory_order_relaxed) && !isValidUtf8(key, strlen(key)))
+				throw Exc(std::string("JSON error: Invalid UTF8 object key: ") + key);
+		}
+	}
+
+	void setStringValidation(bool on)
+	{
+		g_validateStrings.store(on, std::memory_order_relaxed);
+	}
+
+	Value::Value(const char* v) : m_val(checkedString(v)) {}
 
-	Value::Value(const std::string& v) : m_val(json_string_nocheck(v.c_str())) {}
+	Value::Value(const std::string& v) : m_val(checkedString(v.c_str())) {}
 
 	Value::Value(json_t* v) : m_val(json_incref(v)) {}//Internal for borrowed references (hence the ++ref).
 
+#if !defined(ZJSON_INLINE_ACCESSORS)
 	Value::~Value()
 	{
 		json_decref(m_val);
@@ -65,14 +241,18 @@ namespace json //using namespace will not work for the free functions
 		json_decref(m_val);
 		m_val = json_incref(rhs.m_val);
 	}
+#endif
 
 	Value Value::deepCopy() const
 	{
+		ZJSON_TRACE_SCOPE(TraceOp::DeepCopy);
 		Value ret;
 		ret.m_val = json_deep_copy(m_val);
+		ZJSON_TRACE_DONE(json_is_object(m_val) ? json_object_size(m_val) : json_is_array(m_val) ? json_array_size(m_val) : 0);
 		return ret;
 	}
 
+#if !defined(ZJSON_INLINE_ACCESSORS)
 	bool Value::isNull() const
 	{
 		return json_is_null(m_val);
@@ -107,12 +287,496 @@ namespace json //using namespace will not work for the free functions
 	{
 		return json_is_object(m_val);
 	}
+#endif
+	namespace
+	{
+		//Per thread side table of data cached for json nodes, keyed by the node address. The nodes are not referenced by the
+		//cache: their entries are dropped (by any thread, see dropCached()) when they are freed or about to be modified in place.
+		struct NodeCacheEntry
+		{
+			bool hasHash{ false };
+			uint64_t hash{ 0 };
+			bool cacheDump{ false };//Value::cacheDump() opt-in (inherited by the copies made by cow())
+			std::vector<std::pair<uint64_t, std::string>> dumps;//serialized text per format (dump flags and depth)
+			std::vector<std::pair<const char*, const json_t*>> canonicalMembers;//RFC 8785 key order (objects with many keys)
+		};
+
+		//Counting filter of the cached node addresses (of all the threads), so that the frees and the in place modifications
+		//of the other nodes skip the caches
+		const size_t CACHE_FILTER_SZ{ size_t(1) << 16 };
+		std::atomic<uint32_t> g_cacheFilter[CACHE_FILTER_SZ];
+		std::atomic<size_t> g_cachedNodes{ 0 };
+
+		size_t cacheFilterIdx(const void* v)
+		{
+			return size_t((uint64_t(uintptr_t(v) >> 4) * 0x9e3779b97f4a7c15ull) >> 48) & (CACHE_FILTER_SZ - 1);
+		}
+
+		class NodeCache;
+		struct CacheRegistry
+		{
+			std::mutex mutex;
+			std::vector<NodeCache*> caches;
+		};
+		CacheRegistry& cacheRegistry()
+		{//never destroyed: the thread caches may outlive the statics
+			static CacheRegistry* ret{ new CacheRegistry };
+			return *ret;
+		}
+		class NodeCache
+		{
+		public:
+			~NodeCache()
+			{
+				if (!m_registered)
+					return;
+				CacheRegistry& registry = cacheRegistry();
+				std::lock_guard<std::mutex> regLock(registry.mutex);
+				registry.caches.erase(std::find(registry.caches.begin(), registry.caches.end(), this));
+				for (const auto& el : m_entries)
+					unfilter(el.first);
+			}
+			bool empty() const { return 0 == m_size.load(std::memory_order_relaxed); }
+			NodeCacheEntry* find(const json_t* v)
+			{//the entry stays valid while its node is alive and not modified
+				std::lock_guard<std::mutex> lock(m_mutex);
+				const auto it = m_entries.find(v);
+				return m_entries.end() == it ? nullptr : &it->second;
+			}
+			NodeCacheEntry& get(const json_t* v)
+			{
+				if (!m_registered)
+					registerCache();
+				std::lock_guard<std::mutex> lock(m_mutex);
+				auto it = m_entries.find(v);
+				if (m_entries.end() == it)
+				{
+					g_cacheFilter[cacheFilterIdx(v)].fetch_add(1, std::memory_order_relaxed);
+					g_cachedNodes.fetch_add(1, std::memory_order_relaxed);
+					it = m_entries.emplace(v, NodeCacheEntry{}).first;
+					m_size.store(m_entries.size(), std::memory_order_relaxed);
+				}
+				return it->second;
+			}
+			void onCopied(const json_t* orig, const json_t* copy)
+			{//cow() just detached from orig (which is unchanged)
+				const NodeCacheEntry* pEntry = find(orig);
+				if (pEntry && pEntry->cacheDump)
+					get(copy).cacheDump = true;
+			}
+			//v is freed (or its data is about to change). Called by any thread
+			void drop(const void* v, bool freed)
+			{
+				std::lock_guard<std::mutex> lock(m_mutex);
+				const auto it = m_entries.find((const json_t*)v);
+				if (m_entries.end() == it)
+					return;
+				if (!freed && it->second.cacheDump)
+				{//the opt-in stays
+					it->second = NodeCacheEntry{};
+					it->second.cacheDump = true;
+					return;
+				}
+				unfilter(it->first);
+				m_entries.erase(it);
+				m_size.store(m_entries.size(), std::memory_order_relaxed);
+			}
+
+		private:
+			std::mutex m_mutex;//the other threads drop entries too
+			std::unordered_map<const json_t*, NodeCacheEntry> m_entries;
+			std::atomic<size_t> m_size{ 0 };
+			bool m_registered{ false };
+
+			void registerCache()
+			{
+				CacheRegistry& registry = cacheRegistry();
+				std::lock_guard<std::mutex> regLock(registry.mutex);
+				registry.caches.push_back(this);
+				m_registered = true;
+			}
+			static void unfilter(const void* v)
+			{
+				g_cacheFilter[cacheFilterIdx(v)].fetch_sub(1, std::memory_order_relaxed);
+				g_cachedNodes.fetch_sub(1, std::memory_order_relaxed);
+			}
+		};
+
+		//Drops the cached data of a node which is freed or modified in place, from the caches of all the threads
+		void dropCached(const void* v, bool freed)
+		{
+			//the thread which cached v released its reference before (jansson's refcount is a release sequence)
+			std::atomic_thread_fence(std::memory_order_acquire);
+			if (0 == g_cachedNodes.load(std::memory_order_relaxed) || 0 == g_cacheFilter[cacheFilterIdx(v)].load(std::memory_order_relaxed))
+				return;
+			CacheRegistry& registry = cacheRegistry();
+			std::lock_guard<std::mutex> regLock(registry.mutex);
+			for (NodeCache* pCache : registry.caches)
+				pCache->drop(v, freed);
+		}
+		thread_local NodeCache tl_nodeCache;
+		thread_local bool tl_hashCaching{ false };
+		thread_local bool tl_canonicalCaching{ false };
+
+		uint64_t hashMix(uint64_t h)
+		{//murmur3 finalizer
+			h ^= h >> 33;
+			h *= 0xff51afd7ed558ccdull;
+			h ^= h >> 33;
+			h *= 0xc4ceb9fe1a85ec53ull;
+			h ^= h >> 33;
+			return h;
+		}
+
+		uint64_t hashBytes(const char* s, size_t sz)
+		{//FNV-1a
+			uint64_t h{ 0xcbf29ce484222325ull };
+			for (size_t i = 0; i != sz; ++i)
+				h = (h ^ uint8_t(s[i])) * 0x100000001b3ull;
+			return hashMix(h);
+		}
+
+		//Only containers with at least that many nested values get their hashes cached (cheaper to recalculate the small ones)
+		const size_t HASH_CACHE_MIN_NODES{ 16 };
+
+		uint64_t hashNode(const json_t* v, size_t& nodes)
+		{
+			++nodes;
+			switch (json_typeof(v))
+			{
+			case JSON_OBJECT:
+			case JSON_ARRAY:
+			{
+				NodeCacheEntry* pEntry = tl_nodeCache.empty() ? nullptr : tl_nodeCache.find(v);
+				if (pEntry && pEntry->hasHash)
+					return pEntry->hash;
+				const size_t nodesBefore{ nodes };
+				uint64_t h{ 0 };
+				if (JSON_OBJECT == json_typeof(v))
+				{//order independent (same as json_equal)
+					json_t* obj = const_cast<json_t*>(v);
+					for (void* it = json_object_iter(obj); it; it = json_object_iter_next(obj, it))
+					{
+						const char* key = json_object_iter_key(it);
+						h += hashMix(hashBytes(key, strlen(key)) ^ hashNode(json_object_iter_value(it), nodes));
+					}
+					h = hashMix(h ^ 0x6f626a); //"obj"
+				}
+				else
+				{
+					h = 0x617272; //"arr"
+					for (size_t i = 0, iEnd = json_array_size(v); i != iEnd; ++i)
+						h = hashMix(h * 31 + hashNode(json_array_get(v, i), nodes));
+				}
+				if (tl_hashCaching && HASH_CACHE_MIN_NODES <= nodes - nodesBefore)
+				{
+					NodeCacheEntry& entry = pEntry ? *pEntry : tl_nodeCache.get(v);
+					entry.hasHash = true;
+					entry.hash = h;
+				}
+				return h;
+			}
+			case JSON_STRING: return hashBytes(json_string_value(v), json_string_length(v));
+			case JSON_INTEGER: return hashMix(uint64_t(json_integer_value(v)) ^ 0x696e74);
+			case JSON_REAL:
+			{
+				double d = json_real_value(v);
+				if (0. == d)
+					d = 0.;//-0. == 0.
+				uint64_t bits;
+				memcpy(&bits, &d, sizeof(bits));
+				return hashMix(bits ^ 0x7265616c);
+			}
+			case JSON_TRUE: return 0x74727565;
+			case JSON_FALSE: return 0x66616c7365;
+			default: return 0x6e756c6c;
+			}
+		}
+
+		uint64_t hashNode(const json_t* v)
+		{
+			size_t nodes{ 0 };
+			return hashNode(v, nodes);
+		}
+
+		bool cachedHash(const json_t* v, uint64_t& hash)
+		{
+			const NodeCacheEntry* pEntry = tl_nodeCache.empty() ? nullptr : tl_nodeCache.find(v);
+			if (!pEntry || !pEntry->hasHash)
+				return false;
+			hash = pEntry->hash;
+			return true;
+		}
+	}
+
+	void setHashCaching(bool enable)
+	{
+		tl_hashCaching = enable;
+	}
+
+	namespace
+	{
+		struct AllocHeader
+		{
+			size_t size;
+#if defined(ZJSON_PMR)
+			std::pmr::memory_resource* resource;//nullptr for malloc
+#endif
+		};
+		const size_t ALLOC_ALIGN{ alignof(std::max_align_t) };
+		const size_t ALLOC_HEADER_SZ{ (sizeof(AllocHeader) + ALLOC_ALIGN - 1) / ALLOC_ALIGN * ALLOC_ALIGN };//keeps the jansson blocks aligned
+		const size_t ALLOC_HISTOGRAM_SZ{ 18 };//16 bytes to 2MB (powers of 2), then more
+
+		struct ProcessMemoryStats
+		{
+			std::atomic<bool> enabled{ false };
+			std::atomic<uint64_t> allocs{ 0 };
+			std::atomic<uint64_t> frees{ 0 };
+			std::atomic<uint64_t> allocBytes{ 0 };
+			std::atomic<uint64_t> freeBytes{ 0 };
+			std::atomic<int64_t> peakBytes{ 0 };
+			std::atomic<uint64_t> histogram[ALLOC_HISTOGRAM_SZ + 1]{};
+		} g_memStats;
+		thread_local MemoryCounters tl_memCounters;
+		enum AllocMode : int
+		{
+			NO_ALLOCS,//yet: the headers can still be enabled
+			PLAIN_ALLOCS,//malloc blocks
+			HEADER_ALLOCS//memory stats and/or memory resources, blocks with AllocHeader
+		};
+		std::atomic<int> g_allocMode{ NO_ALLOCS };
+#if defined(ZJSON_PMR)
+		thread_local std::pmr::memory_resource* tl_memResource{ nullptr };
+#endif
+
+		void countAlloc(size_t sz)
+		{
+			++tl_memCounters.allocs;
+			tl_memCounters.allocBytes += sz;
+			tl_memCounters.peakBytes = std::max(tl_memCounters.peakBytes, tl_memCounters.liveBytes());
+			g_memStats.allocs.fetch_add(1, std::memory_order_relaxed);
+			const uint64_t allocated{ g_memStats.allocBytes.fetch_add(sz, std::memory_order_relaxed) + sz };
+			const int64_t live{ int64_t(allocated - g_memStats.freeBytes.load(std::memory_order_relaxed)) };
+			int64_t peak{ g_memStats.peakBytes.load(std::memory_order_relaxed) };
+			while (peak < live && !g_memStats.peakBytes.compare_exchange_weak(peak, live, std::memory_order_relaxed))
+			{}
+			size_t bucket{ 0 };
+			while (bucket != ALLOC_HISTOGRAM_SZ && (size_t(16) << bucket) < sz)
+				++bucket;
+			g_memStats.histogram[bucket].fetch_add(1, std::memory_order_relaxed);
+		}
+
+		void countFree(size_t sz)
+		{
+			++tl_memCounters.frees;
+			tl_memCounters.freeBytes += sz;
+			g_memStats.frees.fetch_add(1, std::memory_order_relaxed);
+			g_memStats.freeBytes.fetch_add(sz, std::memory_order_relaxed);
+		}
+
+		//jansson allocator hooks, installed at startup: they drop the cached data of the freed nodes and, once enabled (memory
+		//stats and/or memory resources), add a header before each block
+		void* jsonMalloc(size_t sz)
+		{
+			int mode{ g_allocMode.load(std::memory_order_relaxed) };
+			if (NO_ALLOCS == mode && g_allocMode.compare_exchange_strong(mode, PLAIN_ALLOCS))
+				mode = PLAIN_ALLOCS;
+			if (HEADER_ALLOCS != mode)
+				return malloc(sz);
+			AllocHeader header{};
+			header.size = sz;
+			char* block;
+#if defined(ZJSON_PMR)
+			header.resource = tl_memResource;
+			if (header.resource)
+			{
+				try
+				{
+					block = (char*)header.resource->allocate(ALLOC_HEADER_SZ + sz, ALLOC_ALIGN);
+				}
+				catch (...)
+				{
+					return nullptr;//jansson reports the failure
+				}
+			}
+			else
+#endif
+				block = (char*)malloc(ALLOC_HEADER_SZ + sz);
+			if (!block)
+				return nullptr;
+			memcpy(block, &header, sizeof(header));
+			if (g_memStats.enabled.load(std::memory_order_relaxed))
+				countAlloc(sz);
+			return block + ALLOC_HEADER_SZ;
+		}
+
+		void jsonFree(void* ptr)
+		{
+			if (!ptr)
+				return;
+			dropCached(ptr, true);//before the address can be reused
+			if (HEADER_ALLOCS != g_allocMode.load(std::memory_order_relaxed))
+				return free(ptr);
+			char* block = (char*)ptr - ALLOC_HEADER_SZ;
+			AllocHeader header;
+			memcpy(&header, block, sizeof(header));
+			if (g_memStats.enabled.load(std::memory_order_relaxed))
+				countFree(header.size);
+#if defined(ZJSON_PMR)
+			if (header.resource)
+				return header.resource->deallocate(block, ALLOC_HEADER_SZ + header.size, ALLOC_ALIGN);
+#endif
+			free(block);
+		}
+
+		void enableHeaderAllocs()
+		{//the blocks allocated before have no header
+			int mode{ NO_ALLOCS };
+			if (!g_allocMode.compare_exchange_strong(mode, HEADER_ALLOCS) && HEADER_ALLOCS != mode)
+				throw Exc("JSON error: enableMemoryStats() and enableMemoryResources() must be called before any value is created");
+		}
+
+		//Once, before any other thread can be in jansson (which reads the hooks unsynchronized), and before the static
+		//Values of the clients (init_priority, init_seg), so that all the nodes are freed by the hooks
+		struct AllocHooksInstaller
+		{
+			AllocHooksInstaller() { json_set_alloc_funcs(&jsonMalloc, &jsonFree); }
+		};
+#if defined(__GNUC__)
+		const AllocHooksInstaller g_allocHooksInstaller __attribute__((init_priority(101)));
+#else
+		const AllocHooksInstaller g_allocHooksInstaller;
+#endif
+	}
+
+	void enableMemoryStats()
+	{
+		g_memStats.enabled = true;
+		enableHeaderAllocs();
+	}
+
+#if defined(ZJSON_PMR)
+	void enableMemoryResources()
+	{
+		enableHeaderAllocs();
+	}
+
+	MemoryResourceScope::MemoryResourceScope(std::pmr::memory_resource* resource)
+		: m_prev(tl_memResource)
+	{
+		if (HEADER_ALLOCS != g_allocMode.load())
+			throw Exc("JSON error: enableMemoryResources() was not called");
+		tl_memResource = resource;
+	}
+
+	MemoryResourceScope::~MemoryResourceScope()
+	{
+		tl_memResource = m_prev;
+	}
+#endif
+
+	MemoryCounters processMemoryCounters()
+	{
+		MemoryCounters ret;
+		ret.allocs = g_memStats.allocs.load(std::memory_order_relaxed);
+		ret.frees = g_memStats.frees.load(std::memory_order_relaxed);
+		ret.allocBytes = g_memStats.allocBytes.load(std::memory_order_relaxed);
+		ret.freeBytes = g_memStats.freeBytes.load(std::memory_order_relaxed);
+		ret.peakBytes = g_memStats.peakBytes.load(std::memory_order_relaxed);
+		return ret;
+	}
+
+	MemoryCounters threadMemoryCounters()
+	{
+		return tl_memCounters;
+	}
+
+	Object memoryStats()
+	{//counters read before building the result (which allocates too)
+		const MemoryCounters counters{ processMemoryCounters() };
+		const MemoryCounters threadCounters{ tl_memCounters };
+		uint64_t histogramCounts[ALLOC_HISTOGRAM_SZ + 1];
+		for (size_t i = 0; i != ALLOC_HISTOGRAM_SZ + 1; ++i)
+			histogramCounts[i] = g_memStats.histogram[i].load(std::memory_order_relaxed);
+
+		Object histogram;
+		for (size_t i = 0; i != ALLOC_HISTOGRAM_SZ + 1; ++i)
+			histogram[ALLOC_HISTOGRAM_SZ == i ? std::string("more") : std::to_string(size_t(16) << i)] = histogramCounts[i];
+		return {
+			{"enabled", g_memStats.enabled.load()}
+			, {"process", Object{{"allocs", counters.allocs}, {"frees", counters.frees}, {"liveBytes", counters.liveBytes()}
+				, {"peakBytes", counters.peakBytes}, {"sizeHistogram", histogram}}}
+			, {"thread", Object{{"allocs", threadCounters.allocs}, {"frees", threadCounters.frees}
+				, {"allocBytes", threadCounters.allocBytes}, {"freeBytes", threadCounters.freeBytes}
+				, {"liveBytes", threadCounters.liveBytes()}, {"peakBytes", threadCounters.peakBytes}}}
+		};
+	}
+
+	namespace
+	{
+		//jansson 2.14 (64 bit) struct sizes
+		size_t nodeMemoryUsage(const json_t* v, std::unordered_set<const json_t*>& shared)
+		{
+			if (-1 == (int64_t)v->refcount || (1 < v->refcount && !shared.insert(v).second))
+				return 0;//static (true, false, null) or already counted
+			size_t ret{ 0 };
+			switch (json_typeof(v))
+			{
+			case JSON_OBJECT:
+			{
+				const size_t sz{ json_object_size(v) };
+				size_t buckets{ 8 };
+				while (buckets <= sz)
+					buckets *= 2;
+				ret = 72 + 16 * buckets;
+				json_t* obj = const_cast<json_t*>(v);
+				for (void* it = json_object_iter(obj); it; it = json_object_iter_next(obj, it))
+					ret += 57 + strlen(json_object_iter_key(it)) + nodeMemoryUsage(json_object_iter_value(it), shared);
+				break;
+			}
+			case JSON_ARRAY:
+			{
+				const size_t sz{ json_array_size(v) };
+				size_t entries{ 8 };
+				while (entries < sz)
+					entries *= 2;
+				ret = 40 + 8 * entries;
+				for (size_t i = 0; i != sz; ++i)
+					ret += nodeMemoryUsage(json_array_get(v, i), shared);
+				break;
+			}
+			case JSON_STRING: ret = 33 + json_string_length(v); break;
+			default: ret = 24;//integer or real
+			}
+			return ret;
+		}
+	}
+
+	size_t Value::memoryUsage() const
+	{
+		std::unordered_set<const json_t*> shared;
+		return m_val ? nodeMemoryUsage(m_val, shared) : 0;
+	}
+
+	size_t Value::hash() const
+	{
+		return m_val ? size_t(hashNode(m_val)) : 0;
+	}
+
 	//deep compare
 	bool Value::operator==(const Value& rhs) const
 	{
-		return (!m_val && !rhs.m_val) || 0 != json_equal(m_val, rhs.m_val);
+		if (m_val == rhs.m_val)
+			return true;
+		if (!m_val || !rhs.m_val)
+			return false;
+		uint64_t lhsHash, rhsHash;//no hashing here: it would walk both values before json_equal() does
+		if (tl_hashCaching && cachedHash(m_val, lhsHash) && cachedHash(rhs.m_val, rhsHash) && lhsHash != rhsHash)
+			return false;
+		return 0 != json_equal(m_val, rhs.m_val);
 	}
 
+#if !defined(ZJSON_INLINE_ACCESSORS)
 	bool Value::asBool() const
 	{
 		if (!json_is_boolean(m_val))
@@ -189,6 +853,7 @@ namespace json //using namespace will not work for the free functions
 			return def;
 		return json_string_value(m_val);
 	}
+#endif
 
 	std::string Value::asStringSafe(std::string def /*= {}*/) const
 	{//copy of the c_str, so that def can be moved on return
@@ -197,6 +862,94 @@ namespace json //using namespace will not work for the free functions
 		return json_string_value(m_val);
 	}
 
+	const char* Error::what() const
+	{
+		switch (code)
+		{
+		case Errc::Ok: return "no error";
+		case Errc::Syntax: return "invalid syntax";
+		case Errc::PrematureEnd: return "premature end of input";
+		case Errc::InvalidUtf8: return "invalid UTF8";
+		case Errc::NumberOutOfRange: return "number out of range";
+		case Errc::TooDeep: return "nesting too deep";
+		case Errc::OutOfMemory: return "out of memory";
+		case Errc::Missing: return "missing value";
+		case Errc::WrongType: return "wrong type";
+		case Errc::TooLarge: return "too large";
+		case Errc::StringTooLong: return "string too long";
+		case Errc::TooManyElements: return "too many elements";
+		case Errc::TooManyKeys: return "too many keys";
+		case Errc::Invalid: return "schema violation";
+		}
+		return "unknown error";
+	}
+
+	namespace
+	{
+		Error accessErr(const json_t* v)
+		{
+			Error ret;
+			ret.code = v ? Errc::WrongType : Errc::Missing;
+			return ret;
+		}
+	}
+
+	Expected<bool> Value::tryAsBool() const
+	{
+		if (!json_is_boolean(m_val))
+			return accessErr(m_val);
+		return json_is_true(m_val);
+	}
+
+	Expected<int64_t> Value::tryAsInt() const
+	{
+		if (!json_is_integer(m_val))
+			return accessErr(m_val);
+		return int64_t(json_integer_value(m_val));
+	}
+
+	Expected<double> Value::tryAsFloat() const
+	{
+		if (!json_is_real(m_val))
+			return accessErr(m_val);
+		return json_real_value(m_val);
+	}
+
+	Expected<double> Value::tryAsFloatNum() const
+	{
+		if (!json_is_number(m_val))
+			return accessErr(m_val);
+		return json_number_value(m_val);
+	}
+
+	Expected<const char*> Value::tryC_str() const
+	{
+		if (!json_is_string(m_val))
+			return accessErr(m_val);
+		return json_string_value(m_val);
+	}
+
+	Expected<std::string> Value::tryAsString() const
+	{
+		if (!json_is_string(m_val))
+			return accessErr(m_val);
+		return std::string{ json_string_value(m_val), json_string_length(m_val) };
+	}
+
+	Expected<Array> Value::tryAsArray() const
+	{
+		if (!json_is_array(m_val))
+			return accessErr(m_val);
+		return Array(reinterpret_cast<const Array&>(*this));
+	}
+
+	Expected<Object> Value::tryAsObject() const
+	{
+		if (!json_is_object(m_val))
+			return accessErr(m_val);
+		return Object(reinterpret_cast<const Object&>(*this));
+	}
+
 	const Array Value::asArray() const
 	{
 		if (!json_is_array(m_val))
@@ -225,29 +978,237 @@ namespace json //using namespace will not work for the free functions
 		return static_cast<const Array&>(*this);
 	}
 
-	bool Value::isEmptyValue() const
+	namespace
 	{
-		if (!isEmpty())
-		{
-			switch (m_val->type)
-			{
-			case JSON_OBJECT: return asObject().empty();
-			case JSON_ARRAY: return asArray().empty();
-			case JSON_STRING: return 0 == *c_str();
-			case JSON_INTEGER: return 0 == asInt();
-			case JSON_REAL: return 0. == asFloat();
-			case JSON_TRUE: return false;
-			case JSON_FALSE: return true;
-			case JSON_NULL: return true;
-			}
+		Path::Step pathStep(std::string key)
+		{//numeric keys can be array indexes too (no leading zeros as in RFC 6901)
+			Path::Step step{ std::move(key) };
+			const std::string& k = step.key;
+			if ("-" == k)
+				step.idx = Path::END_IDX;
+			else if (!k.empty() && k.size() <= 19 && k.find_first_not_of("0123456789") == std::string::npos && ('0' != k[0] || 1 == k.size()))
+				step.idx = size_t(std::stoull(k));
+			return step;
 		}
-		return true;
 	}
 
-	void Value::dump(std::ostream& os) const
+	const size_t Path::NO_IDX;
+	const size_t Path::END_IDX;
+
+	Path Path::fromPointer(const char* pointer)
 	{
-		if (isEmpty())
-			os << "#absent#";
+		Path ret;
+		if (0 == *pointer)
+			return ret;//the whole document
+		if ('/' != *pointer)
+			throw Exc(std::string("JSON error: Invalid JSON pointer (must start with '/'): ") + pointer);
+		std::string key;
+		for (const char* p = pointer + 1;; ++p)
+		{
+			if (0 == *p || '/' == *p)
+			{
+				ret.push_back(pathStep(std::move(key)));
+				key.clear();
+				if (0 == *p)
+					break;
+			}
+			else if ('~' == *p)
+			{
+				if ('0' == p[1])
+					key += '~';
+				else if ('1' == p[1])
+					key += '/';
+				else
+					throw Exc(std::string("JSON error: Invalid JSON pointer escape: ") + pointer);
+				++p;
+			}
+			else
+				key += *p;
+		}
+		return ret;
+	}
+
+	Path Path::fromDotted(const char* dotted)
+	{
+		Path ret;
+		if (0 == *dotted)
+			return ret;
+		for (const char* p = dotted;; ++p)
+		{
+			const char* stepEnd = strchr(p, '.');
+			if (!stepEnd)
+				stepEnd = p + strlen(p);
+			ret.push_back(pathStep({ p, stepEnd }));
+			if (0 == *stepEnd)
+				break;
+			p = stepEnd;
+		}
+		return ret;
+	}
+
+	const Value Path::eval(const Value& root) const
+	{
+		return root.getIn(*this);
+	}
+
+	namespace
+	{
+		json_t* pathStepValue(json_t* v, const Path::Step& step)
+		{
+			if (json_is_object(v) && step.isKey)
+#if 0x020e00 <= JANSSON_VERSION_HEX
+				return json_object_getn(v, step.key.data(), step.key.size());//no strlen per step
+#else
+				return json_object_get(v, step.key.c_str());
+#endif
+			else if (json_is_array(v) && Path::NO_IDX != step.idx)
+				return json_array_get(v, step.idx);//END_IDX included: always out of range
+			return nullptr;
+		}
+
+		bool operator==(const Path::Step& lhs, const Path::Step& rhs)
+		{
+			return lhs.isKey == rhs.isKey && lhs.idx == rhs.idx && lhs.key == rhs.key;
+		}
+	}
+
+	size_t PathSet::add(const Path& path)
+	{
+		size_t nodeIdx{ 0 };
+		for (size_t i = 0, iEnd = path.size(); i != iEnd; ++i)
+		{
+			size_t childIdx{ 0 };
+			for (const auto& child : m_nodes[nodeIdx].children)
+				if (child.first == path[i])
+				{
+					childIdx = child.second;
+					break;
+				}
+			if (0 == childIdx)
+			{
+				childIdx = m_nodes.size();
+				m_nodes[nodeIdx].children.emplace_back(path[i], childIdx);
+				m_nodes.emplace_back();
+			}
+			nodeIdx = childIdx;
+		}
+		m_nodes[nodeIdx].results.push_back(m_pathsCnt);
+		return m_pathsCnt++;
+	}
+
+	std::vector<Value> PathSet::eval(const Value& root) const
+	{
+		std::vector<Value> ret(m_pathsCnt);
+		if (root.m_val)
+			evalNode(m_nodes[0], root.m_val, ret);
+		return ret;
+	}
+
+	void PathSet::evalNode(const Node& node, json_t* v, std::vector<Value>& results) const
+	{
+		for (const size_t resIdx : node.results)
+			results[resIdx] = Value{ v };
+		for (const auto& child : node.children)
+			if (json_t* childV = pathStepValue(v, child.first))
+				evalNode(m_nodes[child.second], childV, results);
+	}
+
+	const Value Value::getIn(const Path& path) const
+	{
+		json_t* v = m_val;
+		for (size_t i = 0, iEnd = path.size(); v && i != iEnd; ++i)
+			v = pathStepValue(v, path[i]);
+		return v;
+	}
+
+	void Value::updateNested(const Path& path, size_t stepIdx, const std::function<Value(const Value&)>& fn)
+	{//The child is detached from its (not shared) parent while updated. So, if not shared otherwise, its cow() does not copy it.
+		if (path.size() == stepIdx)
+			return reset(fn(*this));
+		const Path::Step& step = path[stepIdx];
+		if (!m_val)
+			m_val = step.isKey ? json_object() : json_array();
+		if (json_is_object(m_val) && step.isKey)
+		{
+			const char* key = step.key.c_str();
+			checkKey(key);
+			cow();
+			Value child{ json_object_get(m_val, key) };
+			if (!child.isEmpty())
+				json_object_set_new_nocheck(m_val, key, json_null());
+			try
+			{
+				child.updateNested(path, stepIdx + 1, fn);
+			}
+			catch (...)
+			{
+				if (!child.isEmpty())
+					json_object_set_nocheck(m_val, key, child.m_val);
+				throw;
+			}
+			if (child.isEmpty())
+				json_object_del(m_val, key);
+			else
+				json_object_set_nocheck(m_val, key, child.m_val);
+		}
+		else if (json_is_array(m_val) && Path::NO_IDX != step.idx)
+		{
+			const size_t sz{ json_array_size(m_val) };
+			const size_t idx{ Path::END_IDX == step.idx ? sz : step.idx };
+			if (idx > sz)
+				throw Exc{ "JSON error: Invalid path index " + std::to_string(idx) + " for JSON array with size " + std::to_string(sz) };
+			cow();
+			Value child{ json_array_get(m_val, idx) };
+			if (!child.isEmpty())
+				json_array_set_new(m_val, idx, json_null());
+			try
+			{
+				child.updateNested(path, stepIdx + 1, fn);
+			}
+			catch (...)
+			{
+				if (!child.isEmpty())
+					json_array_set(m_val, idx, child.m_val);
+				throw;
+			}
+			if (idx == sz)
+			{
+				if (!child.isEmpty())
+					json_array_append(m_val, child.m_val);
+			}
+			else if (child.isEmpty())
+				json_array_remove(m_val, idx);
+			else
+				json_array_set(m_val, idx, child.m_val);
+		}
+		else
+			throw Exc("JSON error: Wrong type: " + type2String() + " for path step "
+				+ (step.isKey ? '"' + step.key + '"' : std::to_string(step.idx)));
+	}
+
+	bool Value::isEmptyValue() const
+	{
+		if (!isEmpty())
+		{
+			switch (m_val->type)
+			{
+			case JSON_OBJECT: return asObject().empty();
+			case JSON_ARRAY: return asArray().empty();
+			case JSON_STRING: return 0 == *c_str();
+			case JSON_INTEGER: return 0 == asInt();
+			case JSON_REAL: return 0. == asFloat();
+			case JSON_TRUE: return false;
+			case JSON_FALSE: return true;
+			case JSON_NULL: return true;
+			}
+		}
+		return true;
+	}
+
+	void Value::dump(std::ostream& os) const
+	{
+		if (isEmpty())
+			os << "#absent#";
 		else
 		{
 			os << setIgnoreOutErrs;
@@ -285,9 +1246,18 @@ namespace json //using namespace will not work for the free functions
 			}
 			return s;
 		}
+
+		std::string dumpPrefix(const json_t* v, size_t maxSz);
 	}
 	std::string Value::dump(size_t maxChars /*= 0*/) const
 	{
+		if (0 != maxChars && (json_is_object(m_val) || json_is_array(m_val)))
+			return cutStr(dumpPrefix(m_val, maxChars), maxChars);
+		if (0 != maxChars && json_is_string(m_val))
+		{
+			const char* str = json_string_value(m_val);
+			return cutStr('"' + std::string(str, std::find(str, str + std::min(json_string_length(m_val), maxChars), '\0')) + '"', maxChars);
+		}
 		std::ostringstream os;
 		dump(os);
 		return 0 == maxChars
@@ -295,6 +1265,19 @@ namespace json //using namespace will not work for the free functions
 			: cutStr(os.str(), maxChars);
 	}
 
+	void Value::cacheDump(bool enable /*= true*/) const
+	{
+		if (!json_is_object(m_val) && !json_is_array(m_val))
+			return;
+		if (enable)
+			tl_nodeCache.get(m_val).cacheDump = true;
+		else if (NodeCacheEntry* pEntry = tl_nodeCache.find(m_val))
+		{
+			pEntry->cacheDump = false;
+			pEntry->dumps.clear();
+		}
+	}
+
 	std::string Value::type2String() const
 	{
 		if (NULL == m_val)
@@ -316,10 +1299,16 @@ namespace json //using namespace will not work for the free functions
 	{//read as CopyOnWrite (no domestic animals abused here!)
 		if (1 < m_val->refcount)
 		{
+			ZJSON_TRACE_SCOPE(TraceOp::Cow);
 			json_t* valCopy = json_copy(m_val);//shallow copy will do (if any elem of the orig obj is modified later it will copy itself too)
+			if (!tl_nodeCache.empty())
+				tl_nodeCache.onCopied(m_val, valCopy);
 			json_decref(m_val);
 			m_val = valCopy;
+			ZJSON_TRACE_DONE(json_is_object(m_val) ? json_object_size(m_val) : json_is_array(m_val) ? json_array_size(m_val) : json_is_string(m_val) ? json_string_length(m_val) : 0);
 		}
+		else
+			dropCached(m_val, false);//modified in place
 	}
 
 	Array::Array()
@@ -342,10 +1331,12 @@ namespace json //using namespace will not work for the free functions
 				push_back(el);
 	}
 
+#if !defined(ZJSON_INLINE_ACCESSORS)
 	size_t Array::size() const
 	{
 		return json_array_size(m_val);
 	}
+#endif
 
 	const Value Array::getAt(size_t idx) const
 	{
@@ -403,6 +1394,18 @@ namespace json //using namespace will not work for the free functions
 		json_array_clear(m_val);
 	}
 
+	void Array::setIn(const Path& path, const Value& val)
+	{
+		updateIn(path, [&val](const Value&) { return val; });
+	}
+
+	void Array::updateIn(const Path& path, const std::function<Value(const Value&)>& fn)
+	{
+		if (path.empty() || Path::NO_IDX == path[0].idx)
+			throw Exc("JSON error: Array path must start with an index");
+		updateNested(path, 0, fn);
+	}
+
 	Array::const_iterator::reference Array::const_iterator::operator*() const
 	{
 		m_curVal = m_pMyArr->getAt(m_idx);
@@ -426,10 +1429,12 @@ namespace json //using namespace will not work for the free functions
 			setAt(el.first, el.second);
 	}
 
+#if !defined(ZJSON_INLINE_ACCESSORS)
 	size_t Object::size() const
 	{
 		return json_object_size(m_val);
 	}
+#endif
 
 	bool Object::hasField(const char* key) const
 	{
@@ -454,6 +1459,7 @@ namespace json //using namespace will not work for the free functions
 
 	void Object::setAt(const char* key, const Value& val)
 	{
+		checkKey(key);
 		cow();
 		if (0 != json_object_set_nocheck(m_val, key, val.m_val))
 		{
@@ -470,6 +1476,18 @@ namespace json //using namespace will not work for the free functions
 	}
 
 
+	void Object::setIn(const Path& path, const Value& val)
+	{
+		updateIn(path, [&val](const Value&) { return val; });
+	}
+
+	void Object::updateIn(const Path& path, const std::function<Value(const Value&)>& fn)
+	{
+		if (path.empty() || !path[0].isKey)
+			throw Exc("JSON error: Object path must start with a key");
+		updateNested(path, 0, fn);
+	}
+
 	Object::const_iterator::const_iterator(const Object& jObj, bool atEnd)
 		: m_pMyObj(&jObj)
 		, m_iter(atEnd ? nullptr : json_object_iter(rawObj()))
@@ -488,126 +1506,3821 @@ namespace json //using namespace will not work for the free functions
 		return m_curVal;
 	}
 
-	const int osFormatIdx()
-	{
-		static const auto ret{ std::ios_base::xalloc() };
-		return ret;
-	};
-	std::ostream& operator<<(std::ostream& os, const setOStreamIdent& ident)
+	Value diff(const Value& from, const Value& to)
 	{
-		os.iword(osFormatIdx()) = ident.m_ident;
-		return os;
+		if (!from.isObject() || !to.isObject())
+			return to.isEmpty() ? NULL_VALUE() : to;
+		Object patch;
+		if (from.isSameVal(to))
+			return patch;
+		const Object fromObj = from.asObject();
+		const Object toObj = to.asObject();
+		for (const auto& field : fromObj)
+			if (!toObj.hasField(field.first))
+				patch.setAt(field.first, NULL_VALUE());
+		for (const auto& field : toObj)
+		{
+			const Value fromVal = fromObj[field.first];
+			if (fromVal.isSameVal(field.second))
+				continue;
+			if (fromVal.isObject() && field.second.isObject())
+			{
+				const Value fieldPatch = diff(fromVal, field.second);
+				if (!fieldPatch.asObject().empty())
+					patch.setAt(field.first, fieldPatch);
+			}
+			else if (fromVal != field.second)
+				patch.setAt(field.first, field.second);
+		}
+		return patch;
 	}
 
-	const int osSortedIdx()
-	{
-		static const auto ret{ std::ios_base::xalloc() };
-		return ret;
-	};
-	std::ostream& setOStreamSorted(std::ostream& os)
+	namespace
 	{
-		os.iword(osSortedIdx()) = 1;
-		return os;
+		Value mergePatch(Value target, const Value& patch)
+		{
+			if (!patch.isObject())
+				return patch;
+			Object ret{ target.isObject() ? target.asObjectSafe() : Object{} };
+			target = Value{};//so that ret is not shared (unless it was before)
+			for (const auto& field : patch.asObject())
+			{
+				if (field.second.isNull())
+					ret.erase(field.first);
+				else if (!field.second.isObject())
+					ret.setAt(field.first, field.second);
+				else
+				{
+					Value fieldVal = static_cast<const Object&>(ret)[field.first];
+					if (!fieldVal.isEmpty())
+						ret.setAt(field.first, NULL_VALUE());//detach it, so that it is not shared (unless it was before)
+					ret.setAt(field.first, mergePatch(std::move(fieldVal), field.second));
+				}
+			}
+			return ret;
+		}
 	}
 
-	const int osIgnoreErrsIdx()
-	{
-		static const auto ret{ std::ios_base::xalloc() };
-		return ret;
-	};
-	std::ostream& setIgnoreOutErrs(std::ostream& os)
+	void applyPatch(Value& target, const Value& patch)
 	{
-		os.iword(osIgnoreErrsIdx()) = 1;
-		return os;
+		target = mergePatch(std::move(target), patch);
 	}
 
 	namespace
 	{
-		int ostream_callback(const char* buffer, size_t sz, void* data)
+		void appendBE(std::string& out, uint64_t v, size_t bytes)
 		{
-			std::ostream& os = *(std::ostream*)data;
-			os.write(buffer, sz);
-			return 0;
+			char buf[8];
+			for (size_t i = 0; i != bytes; ++i)
+				buf[i] = char(v >> (8 * (bytes - 1 - i)));
+			out.append(buf, bytes);
 		}
 
-		std::ostream& operator<<(std::ostream& os, json_t* v)
+		uint64_t doubleBits(double d)
 		{
-			if (!os)
-				throw Exc("JSON error: Output stream is not in a good state. Check permissions.");
-			const int ident = os.iword(osFormatIdx());
-			const size_t sortedFlag = (1 == os.iword(osSortedIdx()) ? JSON_SORT_KEYS : 0);
-			int janssonRes = -1;
-			if (0 == ident)
-				janssonRes = json_dump_callback(v, &ostream_callback, &os, JSON_COMPACT | sortedFlag);
-			else
-				janssonRes = json_dump_callback(v, &ostream_callback, &os, JSON_INDENT(ident) | sortedFlag);
+			uint64_t ret;
+			memcpy(&ret, &d, sizeof(ret));
+			return ret;
+		}
 
-			if (0 != janssonRes && 1 != os.iword(osIgnoreErrsIdx()))
-				throw Exc("JSON serialization failed (invalid UTF8 string?)");
-			return os;
+		//Common part of the binary decoders. Keeps the (partially) decoded values in Value-s, so nothing leaks on errors.
+		class BinDecoder
+		{
+		public:
+			BinDecoder(const void* data, size_t sz, const char* format)
+				: m_begin((const uint8_t*)data), m_pos(m_begin), m_end(m_begin + sz), m_format(format)
+			{}
+
+			[[noreturn]] void fail(const char* what) const
+			{
+				throw Exc(std::string("JSON error: ") + m_format + " decoding failure (pos "
+					+ std::to_string(m_pos - m_begin) + "). " + what);
+			}
+			bool atEnd() const { return m_pos == m_end; }
+			uint8_t peek() const
+			{
+				if (atEnd())
+					fail("Unexpected end of input");
+				return *m_pos;
+			}
+			uint8_t byte()
+			{
+				const uint8_t ret{ peek() };
+				++m_pos;
+				return ret;
+			}
+			uint64_t uintBE(size_t bytes)
+			{
+				need(bytes);
+				uint64_t ret{ 0 };
+				for (size_t i = 0; i != bytes; ++i)
+					ret = (ret << 8) | m_pos[i];
+				m_pos += bytes;
+				return ret;
+			}
+			double doubleBE()
+			{
+				const uint64_t bits{ uintBE(8) };
+				double ret;
+				memcpy(&ret, &bits, sizeof(ret));
+				return ret;
+			}
+			double floatBE()
+			{
+				const uint32_t bits{ uint32_t(uintBE(4)) };
+				float ret;
+				memcpy(&ret, &bits, sizeof(ret));
+				return ret;
+			}
+			Value integer(uint64_t v, bool negative)
+			{//negative: v is the two's complement bits
+				if (!negative && v > uint64_t(std::numeric_limits<json_int_t>::max()))
+					fail("Integer out of int64 range");
+				return ValueRaw::steal(json_integer(json_int_t(v)));
+			}
+			Value real(double d)
+			{
+				json_t* ret = json_real(d);
+				if (!ret)
+					fail("NaN or infinite float");
+				return ValueRaw::steal(ret);
+			}
+			Value string(size_t sz)
+			{
+				const char* str = chars(sz);
+				json_t* ret = json_stringn(str, sz);
+				if (!ret)
+					fail("Invalid UTF8 string");
+				return ValueRaw::steal(ret);
+			}
+			const std::string& key(size_t sz)
+			{
+				const char* str = chars(sz);
+				m_key.assign(str, sz);
+				if (m_key.size() != strlen(m_key.c_str()))
+					fail("Object key contains null character");
+				return m_key;
+			}
+			void appendKey(std::string& key, size_t sz)
+			{
+				key.append(chars(sz), sz);
+			}
+			void setField(Value& obj, const std::string& key, Value&& val)
+			{
+				if (0 != json_object_set_new(ValueRaw::get(obj), key.c_str(), ValueRaw::release(val)))
+					fail("Invalid UTF8 object key");
+			}
+			void checkCount(uint64_t cnt) const
+			{//each element is at least 1 byte. Protects from huge allocations
+				if (cnt > uint64_t(m_end - m_pos))
+					fail("Invalid element count");
+			}
+			struct DepthGuard
+			{
+				DepthGuard(BinDecoder& dec) : m_dec(dec)
+				{
+					if (MAX_DEPTH < ++m_dec.m_depth)
+						m_dec.fail("Too deep nesting");
+				}
+				~DepthGuard() { --m_dec.m_depth; }
+				BinDecoder& m_dec;
+			};
+
+		private:
+			static const size_t MAX_DEPTH{ 2048 };//same as jansson's parser
+			const uint8_t* const m_begin;
+			const uint8_t* m_pos;
+			const uint8_t* const m_end;
+			const char* const m_format;
+			size_t m_depth{ 0 };
+			std::string m_key;
+
+			void need(size_t sz) const
+			{
+				if (size_t(m_end - m_pos) < sz)
+					fail("Unexpected end of input");
+			}
+			const char* chars(size_t sz)
+			{
+				need(sz);
+				const char* ret = (const char*)m_pos;
+				m_pos += sz;
+				return ret;
+			}
+		};
+
+		void msgPackHeader(std::string& out, size_t sz, uint8_t fixTag, size_t fixMax, uint8_t tag8, uint8_t tag16, uint8_t tag32)
+		{
+			if (sz <= fixMax)
+				out += char(fixTag | sz);
+			else if (tag8 && sz <= 0xFF)
+				out += char(tag8), out += char(sz);
+			else if (sz <= 0xFFFF)
+				out += char(tag16), appendBE(out, sz, 2);
+			else if (sz <= 0xFFFFFFFF)
+				out += char(tag32), appendBE(out, sz, 4);
+			else
+				throw Exc("JSON error: MessagePack encoding failure. Too big: " + std::to_string(sz));
 		}
-	}
-	std::ostream& operator<<(std::ostream& os, const Array& arrVal)
-	{
-		return os << arrVal.m_val;
-	}
 
-	std::ostream& operator<<(std::ostream& os, const Object& objVal)
-	{
-		return os << objVal.m_val;
-	}
+		void msgPackEncode(const json_t* v, std::string& out)
+		{
+			switch (json_typeof(v))
+			{
+			case JSON_OBJECT:
+			{
+				json_t* obj = const_cast<json_t*>(v);
+				msgPackHeader(out, json_object_size(v), 0x80, 15, 0, 0xde, 0xdf);
+				for (void* it = json_object_iter(obj); it; it = json_object_iter_next(obj, it))
+				{
+					const char* key = json_object_iter_key(it);
+					const size_t keySz{ strlen(key) };
+					msgPackHeader(out, keySz, 0xa0, 31, 0xd9, 0xda, 0xdb);
+					out.append(key, keySz);
+					msgPackEncode(json_object_iter_value(it), out);
+				}
+				break;
+			}
+			case JSON_ARRAY:
+			{
+				const size_t sz{ json_array_size(v) };
+				msgPackHeader(out, sz, 0x90, 15, 0, 0xdc, 0xdd);
+				for (size_t i = 0; i != sz; ++i)
+					msgPackEncode(json_array_get(v, i), out);
+				break;
+			}
+			case JSON_STRING:
+			{
+				const size_t sz{ json_string_length(v) };
+				msgPackHeader(out, sz, 0xa0, 31, 0xd9, 0xda, 0xdb);
+				out.append(json_string_value(v), sz);
+				break;
+			}
+			case JSON_INTEGER:
+			{
+				const json_int_t i{ json_integer_value(v) };
+				if (0 <= i)
+				{
+					if (0x80 > i)
+						out += char(i);
+					else if (0xFF >= i)
+						out += char(0xcc), appendBE(out, uint64_t(i), 1);
+					else if (0xFFFF >= i)
+						out += char(0xcd), appendBE(out, uint64_t(i), 2);
+					else if (0xFFFFFFFFll >= i)
+						out += char(0xce), appendBE(out, uint64_t(i), 4);
+					else
+						out += char(0xcf), appendBE(out, uint64_t(i), 8);
+				}
+				else if (-32 <= i)
+					out += char(i);
+				else if (INT8_MIN <= i)
+					out += char(0xd0), appendBE(out, uint64_t(i), 1);
+				else if (INT16_MIN <= i)
+					out += char(0xd1), appendBE(out, uint64_t(i), 2);
+				else if (INT32_MIN <= i)
+					out += char(0xd2), appendBE(out, uint64_t(i), 4);
+				else
+					out += char(0xd3), appendBE(out, uint64_t(i), 8);
+				break;
+			}
+			case JSON_REAL: out += char(0xcb), appendBE(out, doubleBits(json_real_value(v)), 8); break;
+			case JSON_TRUE: out += char(0xc3); break;
+			case JSON_FALSE: out += char(0xc2); break;
+			case JSON_NULL: out += char(0xc0); break;
+			}
+		}
 
-	namespace
-	{
-		size_t istream_callback(void* buffer, size_t buflen, void* data)
+		Value msgPackDecode(BinDecoder& dec)
 		{
-			std::istream& is = *(std::istream*)data;
-			if (!is.good())
+			const uint8_t tag{ dec.byte() };
+			size_t sz{ 0 };
+			if (0x80 > tag)
+				return dec.integer(tag, false);
+			else if (0xe0 <= tag)
+				return dec.integer(uint64_t(int64_t(int8_t(tag))), true);
+			else if (0xa0 == (tag & 0xe0))
+				return dec.string(tag & 0x1f);
+			else if (0x90 == (tag & 0xf0))
+				sz = tag & 0x0f;
+			else if (0x80 == (tag & 0xf0))
+				sz = tag & 0x0f;
+			switch (tag)
 			{
-				if (is.eof())
-					return 0;
+			case 0xc0: return NULL_VALUE();
+			case 0xc2: return false;
+			case 0xc3: return true;
+			case 0xca: return dec.real(dec.floatBE());
+			case 0xcb: return dec.real(dec.doubleBE());
+			case 0xcc: return dec.integer(dec.uintBE(1), false);
+			case 0xcd: return dec.integer(dec.uintBE(2), false);
+			case 0xce: return dec.integer(dec.uintBE(4), false);
+			case 0xcf: return dec.integer(dec.uintBE(8), false);
+			case 0xd0: return dec.integer(uint64_t(int64_t(int8_t(dec.uintBE(1)))), true);
+			case 0xd1: return dec.integer(uint64_t(int64_t(int16_t(dec.uintBE(2)))), true);
+			case 0xd2: return dec.integer(uint64_t(int64_t(int32_t(dec.uintBE(4)))), true);
+			case 0xd3: return dec.integer(dec.uintBE(8), true);
+			case 0xd9: return dec.string(size_t(dec.uintBE(1)));
+			case 0xda: return dec.string(size_t(dec.uintBE(2)));
+			case 0xdb: return dec.string(size_t(dec.uintBE(4)));
+			case 0xdc: case 0xde: sz = size_t(dec.uintBE(2)); break;
+			case 0xdd: case 0xdf: sz = size_t(dec.uintBE(4)); break;
+			default:
+				if (0x80 != (tag & 0xe0))//neither fixarray nor fixmap
+					dec.fail("Unsupported type (binary, extension or reserved)");
+			}
+			dec.checkCount(sz);
+			const BinDecoder::DepthGuard depthGuard{ dec };
+			if (0x90 == (tag & 0xf0) || 0xdc == tag || 0xdd == tag)
+			{
+				Value arr = ValueRaw::steal(json_array());
+				for (size_t i = 0; i != sz; ++i)
+				{
+					Value el = msgPackDecode(dec);
+					json_array_append_new(ValueRaw::get(arr), ValueRaw::release(el));
+				}
+				return arr;
+			}
+			Value obj = ValueRaw::steal(json_object());
+			for (size_t i = 0; i != sz; ++i)
+			{
+				const uint8_t keyTag{ dec.byte() };
+				size_t keySz;
+				if (0xa0 == (keyTag & 0xe0))
+					keySz = keyTag & 0x1f;
+				else if (0xd9 == keyTag)
+					keySz = size_t(dec.uintBE(1));
+				else if (0xda == keyTag)
+					keySz = size_t(dec.uintBE(2));
+				else if (0xdb == keyTag)
+					keySz = size_t(dec.uintBE(4));
 				else
-					return (size_t)-1;
+					dec.fail("Object key is not a string");
+				const std::string key{ dec.key(keySz) };
+				dec.setField(obj, key, msgPackDecode(dec));
 			}
-			is.read((char*)buffer, buflen);
-			return size_t(is.gcount());
+			return obj;
 		}
 
-		std::istream& operator>>(std::istream& is, json_t*& v)
+		void cborHeader(std::string& out, uint8_t major, uint64_t arg)
 		{
-			if (!is)
-				throw Exc("JSON error: Input stream is not in a good state. Check existence and permissions.");
-			json_decref(v);//first clean any previous values (if any)
-			json_error_t err;
-			v = json_load_callback(istream_callback, &is, 0/*JSON_DISABLE_EOF_CHECK*/, &err);
-			if (NULL == v)
+			major <<= 5;
+			if (24 > arg)
+				out += char(major | arg);
+			else if (0xFF >= arg)
+				out += char(major | 24), appendBE(out, arg, 1);
+			else if (0xFFFF >= arg)
+				out += char(major | 25), appendBE(out, arg, 2);
+			else if (0xFFFFFFFF >= arg)
+				out += char(major | 26), appendBE(out, arg, 4);
+			else
+				out += char(major | 27), appendBE(out, arg, 8);
+		}
+
+		void cborEncode(const json_t* v, std::string& out)
+		{
+			switch (json_typeof(v))
+			{
+			case JSON_OBJECT:
 			{
-				std::ostringstream os;
-				os << "JSON error: Deserialization failure (line "
-					<< err.line << ", clm " << err.column << ", pos " << err.position << "). "
-					<< err.text;
-				throw Exc(os.str());
+				json_t* obj = const_cast<json_t*>(v);
+				cborHeader(out, 5, json_object_size(v));
+				for (void* it = json_object_iter(obj); it; it = json_object_iter_next(obj, it))
+				{
+					const char* key = json_object_iter_key(it);
+					const size_t keySz{ strlen(key) };
+					cborHeader(out, 3, keySz);
+					out.append(key, keySz);
+					cborEncode(json_object_iter_value(it), out);
+				}
+				break;
+			}
+			case JSON_ARRAY:
+			{
+				const size_t sz{ json_array_size(v) };
+				cborHeader(out, 4, sz);
+				for (size_t i = 0; i != sz; ++i)
+					cborEncode(json_array_get(v, i), out);
+				break;
+			}
+			case JSON_STRING:
+			{
+				const size_t sz{ json_string_length(v) };
+				cborHeader(out, 3, sz);
+				out.append(json_string_value(v), sz);
+				break;
+			}
+			case JSON_INTEGER:
+			{
+				const json_int_t i{ json_integer_value(v) };
+				if (0 <= i)
+					cborHeader(out, 0, uint64_t(i));
+				else
+					cborHeader(out, 1, ~uint64_t(i));//-1 - i
+				break;
+			}
+			case JSON_REAL: out += char(0xfb), appendBE(out, doubleBits(json_real_value(v)), 8); break;
+			case JSON_TRUE: out += char(0xf5); break;
+			case JSON_FALSE: out += char(0xf4); break;
+			case JSON_NULL: out += char(0xf6); break;
 			}
-			return is;
 		}
-	}
 
-	std::istream& operator>>(std::istream& is, Array& arrVal)
-	{
-		is >> arrVal.m_val;
-		if (!json_is_array(arrVal.m_val))
-			throw Exc(std::string("JSON error: Deserialization failure: Expecting array but deserialized ") + arrVal.type2String());
+		const uint64_t CBOR_INDEFINITE{ uint64_t(-1) };
+		const uint8_t CBOR_BREAK{ 0xff };
 
-		return is;
+		uint64_t cborArg(BinDecoder& dec, uint8_t info)
+		{
+			if (24 > info)
+				return info;
+			switch (info)
+			{
+			case 24: return dec.uintBE(1);
+			case 25: return dec.uintBE(2);
+			case 26: return dec.uintBE(4);
+			case 27: return dec.uintBE(8);
+			case 31: return CBOR_INDEFINITE;
+			default: dec.fail("Reserved additional info");
+			}
+		}
+
+		double cborHalf(uint16_t half)
+		{
+			const int exp{ (half >> 10) & 0x1f };
+			const int mant{ half & 0x3ff };
+			double ret;
+			if (0 == exp)
+				ret = std::ldexp(mant, -24);
+			else if (31 != exp)
+				ret = std::ldexp(mant + 1024, exp - 25);
+			else
+				ret = 0 == mant ? std::numeric_limits<double>::infinity() : std::numeric_limits<double>::quiet_NaN();
+			return (half & 0x8000) ? -ret : ret;
+		}
+
+		void cborText(BinDecoder& dec, uint64_t arg, std::string& text)
+		{//indefinite length text is a sequence of definite length text chunks
+			if (CBOR_INDEFINITE != arg)
+				return dec.appendKey(text, size_t(arg));
+			for (uint8_t ib = dec.byte(); CBOR_BREAK != ib; ib = dec.byte())
+			{
+				if (3 != (ib >> 5) || 31 == (ib & 0x1f))
+					dec.fail("Invalid text chunk");
+				dec.appendKey(text, size_t(cborArg(dec, ib & 0x1f)));
+			}
+		}
+
+		Value cborDecode(BinDecoder& dec)
+		{
+			uint8_t ib{ dec.byte() };
+			while (6 == ib >> 5)
+			{//tags are ignored. Skipped here, since recursing for each one would bypass the nesting limit
+				if (CBOR_INDEFINITE == cborArg(dec, ib & 0x1f))
+					dec.fail("Invalid indefinite length");
+				ib = dec.byte();
+			}
+			const uint8_t major = ib >> 5;
+			const uint8_t info = ib & 0x1f;
+			if (7 == major)
+			{
+				switch (info)
+				{
+				case 20: return false;
+				case 21: return true;
+				case 22: case 23: return NULL_VALUE();//null, undefined
+				case 25: return dec.real(cborHalf(uint16_t(dec.uintBE(2))));
+				case 26: return dec.real(dec.floatBE());
+				case 27: return dec.real(dec.doubleBE());
+				default: dec.fail("Unsupported simple value");
+				}
+			}
+			const uint64_t arg{ cborArg(dec, info) };
+			if (CBOR_INDEFINITE == arg && 2 > major)
+				dec.fail("Invalid indefinite length");
+			switch (major)
+			{
+			case 0: return dec.integer(arg, false);
+			case 1:
+				if (arg > uint64_t(std::numeric_limits<json_int_t>::max()))
+					dec.fail("Integer out of int64 range");
+				return dec.integer(~arg, true);
+			case 2: dec.fail("Byte strings are not supported");
+			case 3:
+			{
+				if (CBOR_INDEFINITE != arg)
+					return dec.string(size_t(arg));
+				std::string text;
+				cborText(dec, arg, text);
+				json_t* ret = json_stringn(text.c_str(), text.size());
+				if (!ret)
+					dec.fail("Invalid UTF8 string");
+				return ValueRaw::steal(ret);
+			}
+			}
+			if (CBOR_INDEFINITE != arg)
+				dec.checkCount(arg);
+			const BinDecoder::DepthGuard depthGuard{ dec };
+			if (4 == major)
+			{
+				Value arr = ValueRaw::steal(json_array());
+				for (uint64_t i = 0; CBOR_INDEFINITE == arg ? CBOR_BREAK != dec.peek() : i != arg; ++i)
+				{
+					Value el = cborDecode(dec);
+					json_array_append_new(ValueRaw::get(arr), ValueRaw::release(el));
+				}
+				if (CBOR_INDEFINITE == arg)
+					dec.byte();
+				return arr;
+			}
+			Value obj = ValueRaw::steal(json_object());
+			std::string key;
+			for (uint64_t i = 0; CBOR_INDEFINITE == arg ? CBOR_BREAK != dec.peek() : i != arg; ++i)
+			{
+				const uint8_t keyIb{ dec.byte() };
+				if (3 != (keyIb >> 5))
+					dec.fail("Object key is not a text string");
+				key.clear();
+				cborText(dec, cborArg(dec, keyIb & 0x1f), key);
+				if (key.size() != strlen(key.c_str()))
+					dec.fail("Object key contains null character");
+				dec.setField(obj, key, cborDecode(dec));
+			}
+			if (CBOR_INDEFINITE == arg)
+				dec.byte();
+			return obj;
+		}
+
+		template<class DecodeFn>
+		Value binDecode(const void* data, size_t sz, const char* format, DecodeFn decodeFn)
+		{
+			BinDecoder dec{ data, sz, format };
+			Value ret = decodeFn(dec);
+			if (!dec.atEnd())
+				dec.fail("Unexpected data after the end of the value");
+			return ret;
+		}
+	}
+
+	void toMsgPack(const Value& val, std::string& out)
+	{
+		if (val.isEmpty())
+			throw Exc("JSON error: MessagePack encoding failure. Empty value");
+		msgPackEncode(ValueRaw::get(val), out);
+	}
+
+	Value fromMsgPack(const void* data, size_t sz)
+	{
+		return binDecode(data, sz, "MessagePack", &msgPackDecode);
+	}
+
+	void toCbor(const Value& val, std::string& out)
+	{
+		if (val.isEmpty())
+			throw Exc("JSON error: CBOR encoding failure. Empty value");
+		cborEncode(ValueRaw::get(val), out);
+	}
+
+	Value fromCbor(const void* data, size_t sz)
+	{
+		return binDecode(data, sz, "CBOR", &cborDecode);
+	}
+
+	namespace
+	{
+		//Read only memory mapping of a whole file. Not mapped() if empty or can not be mapped (e.g. pipe): the file stays
+		//open then, for read()
+		class MappedFile
+		{
+		public:
+			explicit MappedFile(const char* path)
+			{
+#if defined(_WIN32)
+				const HANDLE file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+				if (INVALID_HANDLE_VALUE == file)
+					throw Exc(std::string("JSON error: Can not open file ") + path);
+				LARGE_INTEGER sz;
+				if (GetFileSizeEx(file, &sz) && 0 < sz.QuadPart)
+				{
+					if (const HANDLE mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL))
+					{
+						m_data = (const char*)MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+						m_sz = m_data ? size_t(sz.QuadPart) : 0;
+						CloseHandle(mapping);//the view keeps it
+					}
+				}
+				if (m_data)
+					CloseHandle(file);
+				else
+					m_file = file;
+#else
+				const int fd = ::open(path, O_RDONLY | O_CLOEXEC);
+				if (0 > fd)
+					throw Exc(std::string("JSON error: Can not open file ") + path);
+				struct stat st;
+				if (0 == fstat(fd, &st) && S_ISREG(st.st_mode) && 0 < st.st_size)
+				{
+					void* data = mmap(NULL, size_t(st.st_size), PROT_READ, MAP_SHARED, fd, 0);
+					if (MAP_FAILED != data)
+					{
+						m_data = (const char*)data;
+						m_sz = size_t(st.st_size);
+					}
+				}
+				if (m_data)
+					::close(fd);
+				else
+					m_fd = fd;
+#endif
+			}
+			~MappedFile()
+			{
+#if defined(_WIN32)
+				if (m_data)
+					UnmapViewOfFile(m_data);
+				if (INVALID_HANDLE_VALUE != m_file)
+					CloseHandle(m_file);
+#else
+				if (m_data)
+					munmap((void*)m_data, m_sz);
+				if (0 <= m_fd)
+					::close(m_fd);
+#endif
+			}
+			MappedFile(const MappedFile&) = delete;
+			MappedFile& operator=(const MappedFile&) = delete;
+
+			bool mapped() const { return nullptr != m_data; }
+			const char* data() const { return m_data; }
+			size_t size() const { return m_sz; }
+			//Appends the rest of the file (not mapped) to buf, in chunkSz steps. false on read error
+			bool read(std::string& buf, size_t chunkSz)
+			{
+				for (;;)
+				{
+					const size_t oldSz{ buf.size() };
+					buf.resize(oldSz + chunkSz);
+#if defined(_WIN32)
+					DWORD readSz;
+					if (!ReadFile(m_file, &buf[oldSz], DWORD(chunkSz), &readSz, NULL))
+					{
+						buf.resize(oldSz);
+						return ERROR_BROKEN_PIPE == GetLastError();//end of a pipe
+					}
+#else
+					const ssize_t readSz{ ::read(m_fd, &buf[oldSz], chunkSz) };
+					if (0 > readSz)
+					{
+						buf.resize(oldSz);
+						if (EINTR == errno)
+							continue;
+						return false;
+					}
+#endif
+					buf.resize(oldSz + size_t(readSz));
+					if (0 == readSz)
+						return true;
+				}
+			}
+
+		private:
+			const char* m_data{ nullptr };
+			size_t m_sz{ 0 };
+#if defined(_WIN32)
+			HANDLE m_file{ INVALID_HANDLE_VALUE };
+#else
+			int m_fd{ -1 };
+#endif
+		};
+
+		//Snapshot format (native byte order, all records 8 bytes aligned, offsets from the start of the snapshot):
+		//header: magic[8], endian tag u32, version u32
+		//records: type u32 (json_type), 0 u32, then by type:
+		// object: count u64, count x {key (string record) offset u64, value offset u64} in the original order,
+		//         count x u32 indexes of the fields sorted by key (strcmp)
+		// array: count u64, count x value offset u64
+		// string: length u64, chars, '\0'
+		// integer: i64, real: double, true/false/null: nothing
+		//trailer: root offset u64, magic[8]
+		//Records are written children first, so the writer does not need to seek.
+		const char SNAPSHOT_MAGIC[8]{ 'Z', 'J', 'S', 'N', 'A', 'P', '0', '1' };
+		const uint32_t SNAPSHOT_ENDIAN_TAG{ 0x01020304 };
+		const uint32_t SNAPSHOT_VERSION{ 1 };
+		const size_t SNAPSHOT_HEADER_SZ{ 16 };
+		const size_t SNAPSHOT_TRAILER_SZ{ 16 };
+		const size_t SNAPSHOT_REC_HEADER_SZ{ 8 };
+
+		class SnapshotWriter
+		{
+		public:
+			explicit SnapshotWriter(std::ostream& os) : m_os(os) {}
+			void write(const json_t* root)
+			{
+				put(SNAPSHOT_MAGIC, sizeof(SNAPSHOT_MAGIC));
+				put(&SNAPSHOT_ENDIAN_TAG, 4);
+				put(&SNAPSHOT_VERSION, 4);
+				putU64(node(root));
+				put(SNAPSHOT_MAGIC, sizeof(SNAPSHOT_MAGIC));
+				flush();
+			}
+
+		private:
+			static const size_t FLUSH_SIZE{ 1024 * 1024 };
+			std::ostream& m_os;
+			std::string m_buf;
+			uint64_t m_off{ 0 };
+			std::unordered_map<const json_t*, uint64_t> m_shared;//values written once (by json_t)
+			std::unordered_map<std::string, uint64_t> m_keys;//keys written once
+
+			void flush()
+			{
+				m_os.write(m_buf.data(), std::streamsize(m_buf.size()));
+				m_buf.clear();
+				if (!m_os)
+					throw Exc("JSON error: Snapshot output failure");
+			}
+			void put(const void* data, size_t sz)
+			{
+				m_buf.append((const char*)data, sz);
+				m_off += sz;
+				if (FLUSH_SIZE <= m_buf.size())
+					flush();
+			}
+			void putU64(uint64_t v) { put(&v, sizeof(v)); }
+			void putU32(uint32_t v) { put(&v, sizeof(v)); }
+			uint64_t recHeader(json_type type)
+			{
+				static const char ZEROS[8]{};
+				put(ZEROS, size_t(0 - m_off) % 8);
+				const uint64_t ret{ m_off };
+				putU32(uint32_t(type));
+				putU32(0);
+				return ret;
+			}
+			uint64_t string(const char* str, size_t sz)
+			{
+				const uint64_t ret{ recHeader(JSON_STRING) };
+				putU64(sz);
+				put(str, sz + 1);
+				return ret;
+			}
+			uint64_t key(const char* key)
+			{
+				const auto it = m_keys.find(key);
+				if (m_keys.end() != it)
+					return it->second;
+				const uint64_t ret{ string(key, strlen(key)) };
+				m_keys.emplace(key, ret);
+				return ret;
+			}
+			uint64_t node(const json_t* v)
+			{
+				const bool shared{ 1 < v->refcount };//true, false and null included
+				if (shared)
+				{
+					const auto it = m_shared.find(v);
+					if (m_shared.end() != it)
+						return it->second;
+				}
+				uint64_t ret;
+				switch (json_typeof(v))
+				{
+				case JSON_OBJECT:
+				{
+					json_t* obj = const_cast<json_t*>(v);
+					std::vector<std::pair<uint64_t, uint64_t>> fields;
+					std::vector<const char*> keys;
+					fields.reserve(json_object_size(v));
+					keys.reserve(json_object_size(v));
+					for (void* it = json_object_iter(obj); it; it = json_object_iter_next(obj, it))
+					{
+						keys.push_back(json_object_iter_key(it));
+						const uint64_t keyOff{ key(keys.back()) };
+						fields.emplace_back(keyOff, node(json_object_iter_value(it)));
+					}
+					std::vector<uint32_t> sorted(keys.size());
+					for (uint32_t i = 0; i != sorted.size(); ++i)
+						sorted[i] = i;
+					std::sort(sorted.begin(), sorted.end(), [&keys](uint32_t lhs, uint32_t rhs) { return 0 > strcmp(keys[lhs], keys[rhs]); });
+					ret = recHeader(JSON_OBJECT);
+					putU64(fields.size());
+					for (const auto& field : fields)
+					{
+						putU64(field.first);
+						putU64(field.second);
+					}
+					for (const uint32_t idx : sorted)
+						putU32(idx);
+					break;
+				}
+				case JSON_ARRAY:
+				{
+					std::vector<uint64_t> elems(json_array_size(v));
+					for (size_t i = 0; i != elems.size(); ++i)
+						elems[i] = node(json_array_get(v, i));
+					ret = recHeader(JSON_ARRAY);
+					putU64(elems.size());
+					for (const uint64_t el : elems)
+						putU64(el);
+					break;
+				}
+				case JSON_STRING: ret = string(json_string_value(v), json_string_length(v)); break;
+				case JSON_INTEGER:
+				{
+					ret = recHeader(JSON_INTEGER);
+					const json_int_t i{ json_integer_value(v) };
+					put(&i, sizeof(i));
+					break;
+				}
+				case JSON_REAL:
+				{
+					ret = recHeader(JSON_REAL);
+					const double d{ json_real_value(v) };
+					put(&d, sizeof(d));
+					break;
+				}
+				default: ret = recHeader(json_typeof(v));
+				}
+				if (shared)
+					m_shared.emplace(v, ret);
+				return ret;
+			}
+		};
+	}
+
+	void writeSnapshot(const Value& val, std::ostream& os)
+	{
+		if (val.isEmpty())
+			throw Exc("JSON error: Snapshot of an empty value");
+		if (!os)
+			throw Exc("JSON error: Output stream is not in a good state. Check permissions.");
+		SnapshotWriter{ os }.write(ValueRaw::get(val));
+	}
+
+	Snapshot::Snapshot(std::shared_ptr<const void> mapping, const void* data, size_t sz)
+		: m_mapping(std::move(mapping))
+	{
+		const char* bytes = (const char*)data;
+		uint32_t endianTag, version;
+		if (SNAPSHOT_HEADER_SZ + SNAPSHOT_TRAILER_SZ > sz || 0 != memcmp(bytes, SNAPSHOT_MAGIC, sizeof(SNAPSHOT_MAGIC))
+			|| 0 != memcmp(bytes + sz - sizeof(SNAPSHOT_MAGIC), SNAPSHOT_MAGIC, sizeof(SNAPSHOT_MAGIC)))
+			throw Exc("JSON error: Not a snapshot");
+		memcpy(&endianTag, bytes + 8, 4);
+		memcpy(&version, bytes + 12, 4);
+		if (SNAPSHOT_ENDIAN_TAG != endianTag || SNAPSHOT_VERSION != version)
+			throw Exc("JSON error: Unsupported snapshot version or byte order");
+		uint64_t rootOff;
+		memcpy(&rootOff, bytes + sz - SNAPSHOT_TRAILER_SZ, sizeof(rootOff));
+		m_root = View{ bytes, sz - SNAPSHOT_TRAILER_SZ, 0 }.at(rootOff);
+	}
+
+	Snapshot Snapshot::open(const char* path)
+	{
+		const auto file = std::make_shared<MappedFile>(path);
+		if (!file->mapped())
+			throw Exc(std::string("JSON error: Can not map snapshot file ") + path);
+		return Snapshot{ file, file->data(), file->size() };
+	}
+
+	Snapshot Snapshot::fromMemory(const void* data, size_t sz)
+	{
+		return Snapshot{ nullptr, data, sz };
+	}
+
+	Snapshot::View Snapshot::View::at(uint64_t off) const
+	{
+		if (0 != off % 8 || SNAPSHOT_HEADER_SZ > off || m_sz < SNAPSHOT_REC_HEADER_SZ || off > m_sz - SNAPSHOT_REC_HEADER_SZ
+			|| JSON_NULL < View{ m_data, m_sz, off }.type())
+			throw Exc("JSON error: Corrupted snapshot (offset " + std::to_string(off) + ")");
+		return { m_data, m_sz, off };
+	}
+
+	int Snapshot::View::type() const
+	{
+		uint32_t ret;
+		memcpy(&ret, m_data + m_off, sizeof(ret));
+		return int(ret);
+	}
+
+	uint64_t Snapshot::View::u64(uint64_t off) const
+	{//off relative to this record
+		off += m_off;
+		if (off > m_sz - 8)
+			throw Exc("JSON error: Corrupted snapshot (offset " + std::to_string(off) + ")");
+		uint64_t ret;
+		memcpy(&ret, m_data + off, sizeof(ret));
+		return ret;
+	}
+
+	void Snapshot::View::checkType(int type, const char* typeName) const
+	{
+		if (!m_data || type != this->type())
+			throw Exc(std::string("JSON error: Wrong snapshot value type. Expected type: ") + typeName);
+	}
+
+	bool Snapshot::View::isNull() const { return m_data && JSON_NULL == type(); }
+	bool Snapshot::View::isBool() const { return m_data && (JSON_TRUE == type() || JSON_FALSE == type()); }
+	bool Snapshot::View::isInt() const { return m_data && JSON_INTEGER == type(); }
+	bool Snapshot::View::isFloat() const { return m_data && JSON_REAL == type(); }
+	bool Snapshot::View::isString() const { return m_data && JSON_STRING == type(); }
+	bool Snapshot::View::isArray() const { return m_data && JSON_ARRAY == type(); }
+	bool Snapshot::View::isObject() const { return m_data && JSON_OBJECT == type(); }
+
+	bool Snapshot::View::asBool() const
+	{
+		if (!isBool())
+			checkType(JSON_TRUE, "boolean");
+		return JSON_TRUE == type();
+	}
+
+	int64_t Snapshot::View::asInt() const
+	{
+		checkType(JSON_INTEGER, "integer");
+		return int64_t(u64(SNAPSHOT_REC_HEADER_SZ));
+	}
+
+	double Snapshot::View::asFloat() const
+	{
+		checkType(JSON_REAL, "float");
+		const uint64_t bits{ u64(SNAPSHOT_REC_HEADER_SZ) };
+		double ret;
+		memcpy(&ret, &bits, sizeof(ret));
+		return ret;
+	}
+
+	double Snapshot::View::asFloatNum() const
+	{
+		return isInt() ? double(asInt()) : asFloat();
+	}
+
+	const char* Snapshot::View::c_str() const
+	{
+		checkType(JSON_STRING, "string");
+		const uint64_t len{ u64(SNAPSHOT_REC_HEADER_SZ) };
+		if (len >= m_sz - m_off - 16)
+			throw Exc("JSON error: Corrupted snapshot (string length)");
+		return m_data + m_off + 16;
+	}
+
+	size_t Snapshot::View::size() const
+	{
+		if (!isArray())
+			checkType(JSON_OBJECT, "array or object");
+		const uint64_t ret{ u64(SNAPSHOT_REC_HEADER_SZ) };
+		if (ret > (m_sz - m_off) / 8)
+			throw Exc("JSON error: Corrupted snapshot (size)");
+		return size_t(ret);
+	}
+
+	Snapshot::View Snapshot::View::operator[](size_t idx) const
+	{
+		checkType(JSON_ARRAY, "array");
+		const size_t sz{ size() };
+		if (idx >= sz)
+			throw Exc{ "Invalid index " + std::to_string(idx) + " for JSON array with size " + std::to_string(sz) };
+		return at(u64(16 + 8 * idx));
+	}
+
+	const char* Snapshot::View::keyAt(size_t idx) const
+	{
+		checkType(JSON_OBJECT, "object");
+		if (idx >= size())
+			throw Exc{ "Invalid field index " + std::to_string(idx) };
+		return at(u64(16 + 16 * idx)).c_str();
+	}
+
+	Snapshot::View Snapshot::View::valueAt(size_t idx) const
+	{
+		checkType(JSON_OBJECT, "object");
+		if (idx >= size())
+			throw Exc{ "Invalid field index " + std::to_string(idx) };
+		return at(u64(16 + 16 * idx + 8));
+	}
+
+	Snapshot::View Snapshot::View::operator[](const char* key) const
+	{
+		checkType(JSON_OBJECT, "object");
+		const size_t sz{ size() };
+		const uint64_t sortedOff{ m_off + 16 + 16 * uint64_t(sz) };
+		if (sortedOff + 4 * uint64_t(sz) > m_sz)
+			throw Exc("JSON error: Corrupted snapshot (object size)");
+		size_t lo{ 0 }, hi{ sz };
+		while (lo < hi)
+		{
+			const size_t mid{ lo + (hi - lo) / 2 };
+			uint32_t fieldIdx;
+			memcpy(&fieldIdx, m_data + sortedOff + 4 * mid, sizeof(fieldIdx));
+			const int cmp{ strcmp(keyAt(fieldIdx), key) };
+			if (0 == cmp)
+				return valueAt(fieldIdx);
+			else if (0 > cmp)
+				lo = mid + 1;
+			else
+				hi = mid;
+		}
+		return {};
+	}
+
+	Snapshot::View Snapshot::View::getIn(const Path& path) const
+	{
+		View ret{ *this };
+		for (size_t i = 0, iEnd = path.size(); !ret.isEmpty() && i != iEnd; ++i)
+		{
+			const Path::Step& step = path[i];
+			if (ret.isObject() && step.isKey)
+				ret = ret[step.key.c_str()];
+			else if (ret.isArray() && step.idx < ret.size())
+				ret = ret[step.idx];
+			else
+				ret = {};
+		}
+		return ret;
+	}
+
+	Value Snapshot::View::toValue() const
+	{
+		if (!m_data)
+			return {};
+		switch (type())
+		{
+		case JSON_OBJECT:
+		{
+			Object ret;
+			for (size_t i = 0, iEnd = size(); i != iEnd; ++i)
+				ret.setAt(keyAt(i), valueAt(i).toValue());
+			return ret;
+		}
+		case JSON_ARRAY:
+		{
+			Array ret;
+			for (size_t i = 0, iEnd = size(); i != iEnd; ++i)
+				ret.push_back((*this)[i].toValue());
+			return ret;
+		}
+		case JSON_STRING: return ValueRaw::steal(json_stringn_nocheck(c_str(), size_t(u64(SNAPSHOT_REC_HEADER_SZ))));
+		case JSON_INTEGER: return asInt();
+		case JSON_REAL: return asFloat();
+		case JSON_TRUE: return true;
+		case JSON_FALSE: return false;
+		default: return NULL_VALUE();
+		}
+	}
+
+	const int osFormatIdx()
+	{
+		static const auto ret{ std::ios_base::xalloc() };
+		return ret;
+	};
+	std::ostream& operator<<(std::ostream& os, const setOStreamIdent& ident)
+	{
+		os.iword(osFormatIdx()) = ident.m_ident;
+		return os;
+	}
+
+	const int osSortedIdx()
+	{
+		static const auto ret{ std::ios_base::xalloc() };
+		return ret;
+	};
+	std::ostream& setOStreamSorted(std::ostream& os)
+	{
+		os.iword(osSortedIdx()) = 1;
+		return os;
+	}
+
+	const int osIgnoreErrsIdx()
+	{
+		static const auto ret{ std::ios_base::xalloc() };
+		return ret;
+	};
+	std::ostream& setIgnoreOutErrs(std::ostream& os)
+	{
+		os.iword(osIgnoreErrsIdx()) = 1;
+		return os;
+	}
+
+	int osParallelIdx()
+	{
+		static const auto ret{ std::ios_base::xalloc() };
+		return ret;
+	}
+	std::ostream& operator<<(std::ostream& os, const setOStreamParallel& parallel)
+	{
+		os.iword(osParallelIdx()) = long(0 != parallel.m_threads ? parallel.m_threads : std::max(1u, std::thread::hardware_concurrency()));
+		return os;
+	}
+
+	int osCanonicalIdx()
+	{
+		static const auto ret{ std::ios_base::xalloc() };
+		return ret;
+	}
+	std::ostream& setOStreamCanonical(std::ostream& os)
+	{
+		os.iword(osCanonicalIdx()) = 1;
+		return os;
+	}
+	void setCanonicalCaching(bool enable)
+	{
+		tl_canonicalCaching = enable;
+	}
+
+	namespace
+	{
+		//Length of the valid UTF8 sequence at s (same rules as jansson), 0 if invalid
+		size_t utf8SeqLen(const uint8_t* s, size_t maxSz)
+		{
+			const uint8_t c{ s[0] };
+			size_t sz;
+			uint32_t codepoint;
+			if (0x80 > c)
+				return 1;
+			else if (0xC2 > c)
+				return 0;//continuation byte or overlong 2 bytes sequence
+			else if (0xE0 > c)
+				sz = 2, codepoint = c & 0x1F;
+			else if (0xF0 > c)
+				sz = 3, codepoint = c & 0x0F;
+			else if (0xF5 > c)
+				sz = 4, codepoint = c & 0x07;
+			else
+				return 0;
+			if (sz > maxSz)
+				return 0;
+			for (size_t i = 1; i != sz; ++i)
+			{
+				if (0x80 != (s[i] & 0xC0))
+					return 0;
+				codepoint = (codepoint << 6) | (s[i] & 0x3F);
+			}
+			if ((3 == sz && (0x800 > codepoint || (0xD800 <= codepoint && 0xDFFF >= codepoint)))
+				|| (4 == sz && (0x10000 > codepoint || 0x10FFFF < codepoint)))
+				return 0;//overlong, surrogate or out of range
+			return sz;
+		}
+
+		//Length of the leading ASCII run
+		size_t asciiPrefix(const uint8_t* s, size_t sz)
+		{
+			size_t i{ 0 };
+#if defined(__AVX2__)
+			for (; i + 32 <= sz; i += 32)
+				if (0 != _mm256_movemask_epi8(_mm256_loadu_si256((const __m256i*)(s + i))))
+					break;
+#elif defined(ZJSON_SSE2)
+			for (; i + 16 <= sz; i += 16)
+				if (0 != _mm_movemask_epi8(_mm_loadu_si128((const __m128i*)(s + i))))
+					break;
+#elif defined(ZJSON_NEON)
+			for (; i + 16 <= sz; i += 16)
+				if (0x80 <= vmaxvq_u8(vld1q_u8(s + i)))
+					break;
+#endif
+			for (; i + 8 <= sz; i += 8)
+			{
+				uint64_t word;
+				memcpy(&word, s + i, 8);
+				if (0 != (word & 0x8080808080808080ull))
+					break;
+			}
+			while (i != sz && 0x80 > s[i])
+				++i;
+			return i;
+		}
+
+		//Length of the leading run of bytes output as they are by the Dumper (ASCII except the control characters, '"' and '\\')
+		size_t plainPrefix(const uint8_t* s, size_t sz)
+		{
+			size_t i{ 0 };
+#if defined(__AVX2__)
+			const __m256i ctrl{ _mm256_set1_epi8(0x20) }, quote{ _mm256_set1_epi8('"') }, backslash{ _mm256_set1_epi8('\\') };
+			for (; i + 32 <= sz; i += 32)
+			{//signed compare: the non ASCII bytes are negative
+				const __m256i v{ _mm256_loadu_si256((const __m256i*)(s + i)) };
+				const __m256i special{ _mm256_or_si256(_mm256_cmpgt_epi8(ctrl, v), _mm256_or_si256(_mm256_cmpeq_epi8(v, quote), _mm256_cmpeq_epi8(v, backslash))) };
+				if (0 != _mm256_movemask_epi8(special))
+					break;
+			}
+#elif defined(ZJSON_SSE2)
+			const __m128i ctrl{ _mm_set1_epi8(0x20) }, quote{ _mm_set1_epi8('"') }, backslash{ _mm_set1_epi8('\\') };
+			for (; i + 16 <= sz; i += 16)
+			{//signed compare: the non ASCII bytes are negative
+				const __m128i v{ _mm_loadu_si128((const __m128i*)(s + i)) };
+				const __m128i special{ _mm_or_si128(_mm_cmplt_epi8(v, ctrl), _mm_or_si128(_mm_cmpeq_epi8(v, quote), _mm_cmpeq_epi8(v, backslash))) };
+				if (0 != _mm_movemask_epi8(special))
+					break;
+			}
+#elif defined(ZJSON_NEON)
+			for (; i + 16 <= sz; i += 16)
+			{
+				const uint8x16_t v{ vld1q_u8(s + i) };
+				const uint8x16_t special{ vorrq_u8(vorrq_u8(vcltq_u8(v, vdupq_n_u8(0x20)), vcgeq_u8(v, vdupq_n_u8(0x80))),
+					vorrq_u8(vceqq_u8(v, vdupq_n_u8('"')), vceqq_u8(v, vdupq_n_u8('\\')))) };
+				if (0 != vmaxvq_u8(special))
+					break;
+			}
+#endif
+			while (i != sz && 0x20 <= s[i] && 0x80 > s[i] && '"' != s[i] && '\\' != s[i])
+				++i;
+			return i;
+		}
+
+		const size_t DUMP_FLUSH_SIZE{ 64 * 1024 };
+		const size_t DUMP_CANONICAL{ size_t(1) << 30 };//Dumper flag (above the jansson ones): RFC 8785 output, with JSON_COMPACT
+
+		//RFC 8785 key order, i.e. by UTF16 code units. Same as the UTF8 byte order, except for the chars above U+FFFF (surrogates
+		//in UTF16) against U+E000..U+FFFF, which differ already at the lead byte
+		bool utf16Less(const char* lhs, const char* rhs)
+		{
+			const uint8_t* l = (const uint8_t*)lhs;
+			const uint8_t* r = (const uint8_t*)rhs;
+			while (0 != *l && *l == *r)
+				++l, ++r;
+			if (0xF0 <= *l && (0xEE == *r || 0xEF == *r))
+				return true;
+			if (0xF0 <= *r && (0xEE == *l || 0xEF == *l))
+				return false;
+			return *l < *r;
+		}
+
+		//Shortest round trip digits of d > 0 (trailing zeros removed) and the exponent n, where d = 0.digits * 10^n
+		size_t shortestDigits(double d, char* digits, int& n)
+		{
+			char buf[40];
+#if defined(__cpp_lib_to_chars)
+			char* end = std::to_chars(buf, buf + sizeof(buf) - 1, d, std::chars_format::scientific).ptr;
+#else
+			int len{ 0 };
+			for (int precision = 0; ; ++precision)
+			{
+				len = snprintf(buf, sizeof(buf), "%.*e", precision, d);
+				if (16 == precision || strtod(buf, nullptr) == d)
+					break;
+			}
+			char* end = buf + len;
+#endif
+			*end = '\0';
+			size_t sz{ 0 };
+			const char* p = buf;
+			for (; p != end && 'e' != *p; ++p)
+				if ('0' <= *p && '9' >= *p)//skips the (locale) decimal point
+					digits[sz++] = *p;
+			n = atoi(p + 1) + 1;
+			while (1 < sz && '0' == digits[sz - 1])
+				--sz;
+			return sz;
+		}
+
+		//ECMAScript Number.prototype.toString() format of a finite double (RFC 8785). out must have 32 chars
+		size_t canonicalDouble(double d, char* out)
+		{
+			if (0. == d)
+				return out[0] = '0', 1;//-0 too
+			char* p = out;
+			if (0. > d)
+			{
+				*p++ = '-';
+				d = -d;
+			}
+			char digits[24];
+			int n;
+			const int k{ int(shortestDigits(d, digits, n)) };
+			if (k <= n && 21 >= n)
+			{
+				memcpy(p, digits, size_t(k));
+				memset(p + k, '0', size_t(n - k));
+				p += n;
+			}
+			else if (0 < n && 21 >= n)
+			{
+				memcpy(p, digits, size_t(n));
+				p[n] = '.';
+				memcpy(p + n + 1, digits + n, size_t(k - n));
+				p += k + 1;
+			}
+			else if (-6 < n && 0 >= n)
+			{
+				*p++ = '0';
+				*p++ = '.';
+				memset(p, '0', size_t(-n));
+				memcpy(p - n, digits, size_t(k));
+				p += k - n;
+			}
+			else
+			{
+				*p++ = digits[0];
+				if (1 < k)
+				{
+					*p++ = '.';
+					memcpy(p, digits + 1, size_t(k - 1));
+					p += k - 1;
+				}
+				p += snprintf(p, 8, "e%c%d", 0 < n ? '+' : '-', std::abs(n - 1));
+			}
+			return size_t(p - out);
+		}
+
+		//With setCanonicalCaching(true), only objects with at least that many keys get their canonical key order cached
+		//(cheaper to sort the small ones)
+		const size_t CANONICAL_CACHE_MIN_KEYS{ 16 };
+		using Members = std::vector<std::pair<const char*, const json_t*>>;
+
+		//object members in the RFC 8785 key order: cached ones, or sorted into scratch
+		const Members& canonicalMembers(const json_t* v, Members& scratch)
+		{
+			NodeCacheEntry* pEntry = tl_canonicalCaching && CANONICAL_CACHE_MIN_KEYS <= json_object_size(v) ? &tl_nodeCache.get(v) : nullptr;
+			if (pEntry && !pEntry->canonicalMembers.empty())
+				return pEntry->canonicalMembers;
+			Members& members = pEntry ? pEntry->canonicalMembers : scratch;
+			json_t* obj = const_cast<json_t*>(v);
+			members.reserve(json_object_size(v));
+			for (void* it = json_object_iter(obj); it; it = json_object_iter_next(obj, it))
+				members.emplace_back(json_object_iter_key(it), json_object_iter_value(it));
+			std::sort(members.begin(), members.end(), [](const Members::value_type& lhs, const Members::value_type& rhs) { return utf16Less(lhs.first, rhs.first); });
+			return members;
+		}
+
+		//Serializer with the same output as jansson's json_dump_callback (for the flags used here), which also splices the
+		//cached text of the Value::cacheDump() subtrees. Writes to a buffer which is flushed (if flushFn) at element boundaries.
+		class Dumper
+		{
+		public:
+			using FlushFn = bool(*)(std::string& buf, void* data);//must empty buf. Return false to stop dumping
+
+			Dumper(size_t flags, std::string& buf, FlushFn flushFn = nullptr, void* flushData = nullptr, size_t flushSize = DUMP_FLUSH_SIZE)
+				: m_flags(flags), m_indent(flags & JSON_MAX_INDENT), m_buf(buf), m_flushFn(flushFn), m_flushData(flushData), m_flushSize(flushSize)
+			{}
+			//false for invalid UTF8 strings or when flushing fails (the output is incomplete then)
+			bool dump(const json_t* v, size_t depth = 0)
+			{
+				switch (json_typeof(v))
+				{
+				case JSON_OBJECT:
+				case JSON_ARRAY:
+					if (!tl_nodeCache.empty())
+						if (NodeCacheEntry* pEntry = tl_nodeCache.find(v))
+							if (pEntry->cacheDump)
+								return dumpCached(v, depth, *pEntry);
+					return JSON_OBJECT == json_typeof(v) ? dumpObject(v, depth) : dumpArray(v, depth);
+				case JSON_STRING: return dumpString(json_string_value(v), json_string_length(v));
+				case JSON_INTEGER: return dumpInt(json_integer_value(v));
+				case JSON_REAL: return dumpReal(v);
+				case JSON_TRUE: return m_buf.append("true", 4), true;
+				case JSON_FALSE: return m_buf.append("false", 5), true;
+				case JSON_NULL: return m_buf.append("null", 4), true;
+				}
+				return false;
+			}
+			bool dumpString(const char* str, size_t sz)
+			{
+				const uint8_t* pos = (const uint8_t*)str;
+				const uint8_t* end = pos + sz;
+				bool cut{ false };
+				if (0 != m_limit && sz > m_limit - std::min(m_limit, m_buf.size()) + 4)
+				{//only the start of a long string (cut at a UTF8 char start to still validate), enough to reach the limit
+					end = pos + (m_limit - std::min(m_limit, m_buf.size()) + 4);
+					while (end != pos && 0x80 == (*end & 0xC0))
+						--end;
+					cut = true;
+				}
+				const uint8_t* runStart = pos;
+				m_buf += '"';
+				while (pos != end)
+				{
+					pos += plainPrefix(pos, size_t(end - pos));
+					if (pos == end)
+						break;
+					const uint8_t c{ *pos };
+					if (0x80 <= c)
+					{
+						const size_t seqLen{ utf8SeqLen(pos, size_t(end - pos)) };
+						if (0 == seqLen)
+							return false;
+						pos += seqLen;
+						continue;
+					}
+					if (0x20 <= c && '"' != c && '\\' != c)
+					{
+						++pos;
+						continue;
+					}
+					m_buf.append((const char*)runStart, size_t(pos - runStart));
+					switch (c)
+					{
+					case '"': m_buf.append("\\\"", 2); break;
+					case '\\': m_buf.append("\\\\", 2); break;
+					case '\b': m_buf.append("\\b", 2); break;
+					case '\f': m_buf.append("\\f", 2); break;
+					case '\n': m_buf.append("\\n", 2); break;
+					case '\r': m_buf.append("\\r", 2); break;
+					case '\t': m_buf.append("\\t", 2); break;
+					default:
+					{
+						const char* HEX{ m_flags & DUMP_CANONICAL ? "0123456789abcdef" : "0123456789ABCDEF" };
+						const char seq[]{ '\\', 'u', '0', '0', HEX[c >> 4], HEX[c & 0xF] };
+						m_buf.append(seq, sizeof(seq));
+					}
+					}
+					runStart = ++pos;
+				}
+				m_buf.append((const char*)runStart, size_t(pos - runStart));
+				if (cut)
+					return false;
+				m_buf += '"';
+				return true;
+			}
+			bool flush()
+			{
+				if (!m_flushFn || m_buf.empty())
+					return true;
+				m_flushed += m_buf.size();
+				return m_flushFn(m_buf, m_flushData);
+			}
+			size_t outputSize() const { return m_flushed + m_buf.size(); }
+			bool flushIfFull() { return (0 == m_limit || m_limit > m_buf.size()) && (m_flushSize > m_buf.size() || flush()); }
+			//stop (fail) once the output has maxSz bytes (maybe more), without flushing. 0 for no limit
+			void limit(size_t maxSz) { m_limit = maxSz; }
+			void indent(size_t depth, bool space)
+			{
+				if (0 != m_indent)
+				{
+					m_buf += '\n';
+					m_buf.append(depth * m_indent, ' ');
+				}
+				else if (space && !(m_flags & JSON_COMPACT))
+					m_buf += ' ';
+			}
+			void keySeparator()
+			{
+				if (m_flags & JSON_COMPACT)
+					m_buf += ':';
+				else
+					m_buf.append(": ", 2);
+			}
+			bool dumpInt(json_int_t i)
+			{
+				const json_int_t MAX_SAFE_INT{ (json_int_t(1) << 53) - 1 };
+				if ((m_flags & DUMP_CANONICAL) && (MAX_SAFE_INT < i || -MAX_SAFE_INT > i))
+					return dumpDouble(double(i));//the RFC 8785 numbers are doubles
+				char buf[24];
+				char* p = buf + sizeof(buf);
+				uint64_t u{ 0 > i ? 0 - uint64_t(i) : uint64_t(i) };
+				do
+					*--p = char('0' + u % 10);
+				while (0 != (u /= 10));
+				if (0 > i)
+					*--p = '-';
+				m_buf.append(p, size_t(buf + sizeof(buf) - p));
+				return true;
+			}
+			//array elements [begin, end) with their separators, without the brackets
+			bool dumpElements(const json_t* v, size_t begin, size_t end, size_t depth)
+			{
+				const size_t sz{ json_array_size(v) };
+				for (size_t i = begin; i != end; ++i)
+				{
+					if (!dump(json_array_get(v, i), depth + 1))
+						return false;
+					if (i + 1 != sz)
+					{
+						m_buf += ',';
+						indent(depth + 1, true);
+					}
+					else
+						indent(depth, false);
+					if (!flushIfFull())
+						return false;
+				}
+				return true;
+			}
+			//object member with its separator
+			bool dumpMember(const char* key, const json_t* val, size_t depth, bool last)
+			{
+				if (!dumpString(key, strlen(key)))
+					return false;
+				keySeparator();
+				if (!dump(val, depth + 1))
+					return false;
+				if (!last)
+				{
+					m_buf += ',';
+					indent(depth + 1, true);
+				}
+				else
+					indent(depth, false);
+				return flushIfFull();
+			}
+			bool dumpDouble(double d)
+			{//false for NaN and infinity (same as jansson)
+				if (m_flags & DUMP_CANONICAL)
+				{
+					if (!std::isfinite(d))
+						return false;
+					char buf[32];
+					m_buf.append(buf, canonicalDouble(d, buf));
+					return true;
+				}
+				json_t* real = json_real(d);
+				const bool ret{ real && dumpReal(real) };
+				json_decref(real);
+				return ret;
+			}
+
+		private:
+			const size_t m_flags;
+			const size_t m_indent;
+			std::string& m_buf;
+			FlushFn m_flushFn;
+			void* m_flushData;
+			const size_t m_flushSize;
+			size_t m_flushed{ 0 };
+			size_t m_limit{ 0 };
+
+			bool dumpReal(const json_t* v)
+			{//let jansson format the reals: its format differs from printf("%.17g")
+				if (m_flags & DUMP_CANONICAL)
+					return dumpDouble(json_real_value(v));
+				char buf[64];
+				const size_t sz{ json_dumpb(v, buf, sizeof(buf), JSON_ENCODE_ANY) };
+				if (0 == sz || sizeof(buf) < sz)
+					return false;
+				m_buf.append(buf, sz);
+				return true;
+			}
+			bool dumpArray(const json_t* v, size_t depth)
+			{
+				const size_t sz{ json_array_size(v) };
+				m_buf += '[';
+				if (0 == sz)
+					return m_buf += ']', true;
+				indent(depth + 1, false);
+				if (!dumpElements(v, 0, sz, depth))
+					return false;
+				m_buf += ']';
+				return true;
+			}
+			bool dumpObject(const json_t* v, size_t depth)
+			{
+				json_t* obj = const_cast<json_t*>(v);
+				void* iter = json_object_iter(obj);
+				m_buf += '{';
+				if (!iter)
+					return m_buf += '}', true;
+				indent(depth + 1, false);
+				if (m_flags & DUMP_CANONICAL)
+				{
+					Members scratch;
+					const Members& members = canonicalMembers(v, scratch);
+					for (size_t i = 0; i != members.size(); ++i)
+						if (!dumpMember(members[i].first, members[i].second, depth, i + 1 == members.size()))
+							return false;
+				}
+				else if (m_flags & JSON_SORT_KEYS)
+				{
+					std::vector<const char*> keys;
+					keys.reserve(json_object_size(v));
+					for (; iter; iter = json_object_iter_next(obj, iter))
+						keys.push_back(json_object_iter_key(iter));
+					std::sort(keys.begin(), keys.end(), [](const char* lhs, const char* rhs) { return 0 > strcmp(lhs, rhs); });
+					for (size_t i = 0; i != keys.size(); ++i)
+						if (!dumpMember(keys[i], json_object_get(v, keys[i]), depth, i + 1 == keys.size()))
+							return false;
+				}
+				else
+				{
+					while (iter)
+					{
+						void* next = json_object_iter_next(obj, iter);
+						if (!dumpMember(json_object_iter_key(iter), json_object_iter_value(iter), depth, !next))
+							return false;
+						iter = next;
+					}
+				}
+				m_buf += '}';
+				return true;
+			}
+			bool dumpCached(const json_t* v, size_t depth, NodeCacheEntry& entry)
+			{//indented text depends on the depth too
+				const uint64_t fmtKey{ uint64_t(m_flags) | (0 == m_indent ? 0 : uint64_t(depth) << 32) };
+				for (const auto& el : entry.dumps)
+					if (fmtKey == el.first)
+						return m_buf.append(el.second), true;
+				std::string text;
+				Dumper dumper(m_flags, text);
+				if (!(JSON_OBJECT == json_typeof(v) ? dumper.dumpObject(v, depth) : dumper.dumpArray(v, depth)))
+					return false;
+				m_buf.append(text);
+				entry.dumps.emplace_back(fmtKey, std::move(text));
+				return true;
+			}
+		};
+
+		std::string dumpPrefix(const json_t* v, size_t maxSz)
+		{//compact output, cut after more than maxSz bytes (or at an invalid UTF8 string, same as setIgnoreOutErrs)
+			std::string buf;
+			Dumper dumper(JSON_COMPACT, buf);
+			dumper.limit(maxSz + 1);
+			dumper.dump(v);
+			return buf;
+		}
+
+		bool ostreamFlush(std::string& buf, void* data)
+		{
+			std::ostream& os = *(std::ostream*)data;
+			os.write(buf.data(), std::streamsize(buf.size()));
+			buf.clear();
+			return true;
+		}
+
+		size_t osDumpFlags(std::ostream& os)
+		{
+			if (1 == os.iword(osCanonicalIdx()))
+				return JSON_COMPACT | DUMP_CANONICAL;
+			const int ident = os.iword(osFormatIdx());
+			const size_t sortedFlag = (1 == os.iword(osSortedIdx()) ? JSON_SORT_KEYS : 0);
+			return (0 == ident ? JSON_COMPACT : JSON_INDENT(ident)) | sortedFlag;
+		}
+
+		const size_t PARALLEL_DUMP_MIN_NODES{ 64 * 1024 };//smaller values are dumped serially
+		const size_t PARALLEL_DUMP_TASKS_PER_THREAD{ 8 };//containers with that many children per thread are split in ranges
+		const size_t PARALLEL_DUMP_MAX_NESTING{ 4 };//deeper containers are dumped whole by a single task
+		const size_t PARALLEL_DUMP_WINDOW_PER_THREAD{ 4 };//dumped tasks waiting for the output (memory bound)
+
+		//true if v has at least n nodes (stops counting there)
+		bool hasNodes(const json_t* v, size_t& n)
+		{
+			if (0 == n || 0 == --n)
+				return true;
+			if (json_is_array(v))
+			{
+				for (size_t i = 0, sz = json_array_size(v); i != sz; ++i)
+					if (hasNodes(json_array_get(v, i), n))
+						return true;
+			}
+			else if (json_is_object(v))
+			{
+				json_t* obj = const_cast<json_t*>(v);
+				for (void* iter = json_object_iter(obj); iter; iter = json_object_iter_next(obj, iter))
+					if (hasNodes(json_object_iter_value(iter), n))
+						return true;
+			}
+			return false;
+		}
+
+		//Dumps the big containers in element ranges on worker threads into separate buffers, the brackets, keys and
+		//small values in between are dumped by the planning thread. The buffers are output in order, so the bytes
+		//(and the partial output on failure) are the same as the serial Dumper's.
+		class ParallelDumper
+		{
+		public:
+			ParallelDumper(size_t flags, unsigned threads) : m_flags(flags), m_threads(threads) {}
+			~ParallelDumper() { stop(); }
+
+			bool dump(const json_t* v, std::ostream& os, size_t& outSize)
+			{
+				plan(v, 0, 0);
+				const size_t window{ m_threads * PARALLEL_DUMP_WINDOW_PER_THREAD };
+				for (unsigned i = 0; i != m_threads; ++i)
+					m_workers.emplace_back([this, window]() { work(window); });
+				bool ok{ true };
+				for (size_t i = 0; ok && i != m_segs.size(); ++i)
+				{
+					Segment& seg = m_segs[i];
+					if (seg.v)
+					{
+						std::unique_lock<std::mutex> lock(m_mutex);
+						m_cond.wait(lock, [&seg]() { return seg.done; });
+					}
+					if (m_error)
+						std::rethrow_exception(m_error);
+					os.write(seg.out.data(), std::streamsize(seg.out.size()));
+					outSize += seg.out.size();
+					std::string().swap(seg.out);
+					ok = seg.ok;
+					{
+						std::lock_guard<std::mutex> lock(m_mutex);
+						m_written = i + 1;
+					}
+					m_cond.notify_all();
+				}
+				stop();
+				return ok;
+			}
+
+		private:
+			struct Segment
+			{
+				const json_t* v{ nullptr };//nullptr for the text dumped while planning
+				const std::vector<const char*>* keys{ nullptr };//object members to dump
+				size_t begin{ 0 };
+				size_t end{ 0 };
+				size_t depth{ 0 };
+				std::string out;
+				bool ok{ true };
+				bool done{ false };
+			};
+			const size_t m_flags;
+			const unsigned m_threads;
+			std::deque<Segment> m_segs;//stable addresses
+			std::deque<std::vector<const char*>> m_keys;
+			std::vector<std::thread> m_workers;
+			std::mutex m_mutex;
+			std::condition_variable m_cond;
+			std::atomic<size_t> m_next{ 0 };
+			size_t m_written{ 0 };
+			bool m_stop{ false };
+			std::exception_ptr m_error;
+
+			std::string& text()
+			{
+				if (m_segs.empty() || m_segs.back().v)
+					m_segs.emplace_back();
+				return m_segs.back().out;
+			}
+			bool plan(const json_t* v, size_t depth, size_t nesting)
+			{
+				const bool isObject{ json_is_object(v) };
+				const size_t sz{ isObject ? json_object_size(v) : json_array_size(v) };
+				if (0 == sz || PARALLEL_DUMP_MAX_NESTING == nesting)
+					return addTask(v, nullptr, 0, 0, depth);
+				const std::vector<const char*>* keys{ nullptr };
+				if (isObject)
+				{
+					m_keys.emplace_back();
+					std::vector<const char*>& objKeys = m_keys.back();
+					objKeys.reserve(sz);
+					json_t* obj = const_cast<json_t*>(v);
+					for (void* iter = json_object_iter(obj); iter; iter = json_object_iter_next(obj, iter))
+						objKeys.push_back(json_object_iter_key(iter));
+					if (m_flags & JSON_SORT_KEYS)
+						std::sort(objKeys.begin(), objKeys.end(), [](const char* lhs, const char* rhs) { return 0 > strcmp(lhs, rhs); });
+					keys = &objKeys;
+				}
+				text() += isObject ? '{' : '[';
+				Dumper(m_flags, text()).indent(depth + 1, false);
+				if (m_threads * PARALLEL_DUMP_TASKS_PER_THREAD <= sz)
+				{
+					const size_t step{ (sz + m_threads * PARALLEL_DUMP_TASKS_PER_THREAD - 1) / (m_threads * PARALLEL_DUMP_TASKS_PER_THREAD) };
+					for (size_t begin = 0; begin < sz; begin += step)
+						addTask(v, keys, begin, std::min(sz, begin + step), depth);
+				}
+				else
+				{
+					for (size_t i = 0; i != sz; ++i)
+					{
+						const json_t* child{ keys ? json_object_get(v, (*keys)[i]) : json_array_get(v, i) };
+						Dumper dumper(m_flags, text());
+						if (keys)
+						{
+							if (!dumper.dumpString((*keys)[i], strlen((*keys)[i])))
+								return failed();
+							dumper.keySeparator();
+						}
+						if (json_is_object(child) || json_is_array(child))
+						{
+							if (!plan(child, depth + 1, nesting + 1))
+								return false;
+						}
+						else if (!dumper.dump(child, depth + 1))
+							return failed();
+						Dumper separator(m_flags, text());
+						if (i + 1 != sz)
+						{
+							text() += ',';
+							separator.indent(depth + 1, true);
+						}
+						else
+							separator.indent(depth, false);
+					}
+				}
+				text() += isObject ? '}' : ']';
+				return true;
+			}
+			bool addTask(const json_t* v, const std::vector<const char*>* keys, size_t begin, size_t end, size_t depth)
+			{
+				m_segs.emplace_back();
+				Segment& seg = m_segs.back();
+				seg.v = v;
+				seg.keys = keys;
+				seg.begin = begin;
+				seg.end = end;
+				seg.depth = depth;
+				return true;
+			}
+			bool failed()
+			{//the text so far is output, nothing after it
+				m_segs.back().ok = false;
+				return false;
+			}
+			static bool run(Segment& seg, size_t flags)
+			{
+				Dumper dumper(flags, seg.out);
+				if (seg.begin == seg.end)//whole value
+					return dumper.dump(seg.v, seg.depth);
+				for (size_t i = seg.begin; i != seg.end; ++i)
+				{
+					const bool ok{ seg.keys
+						? dumper.dumpMember((*seg.keys)[i], json_object_get(seg.v, (*seg.keys)[i]), seg.depth, i + 1 == seg.keys->size())
+						: dumper.dumpElements(seg.v, i, i + 1, seg.depth) };
+					if (!ok)
+						return false;
+				}
+				return true;
+			}
+			void work(size_t window)
+			{
+				for (;;)
+				{
+					const size_t i{ m_next++ };
+					if (i >= m_segs.size())
+						return;
+					Segment& seg = m_segs[i];
+					if (!seg.v)
+						continue;
+					{
+						std::unique_lock<std::mutex> lock(m_mutex);
+						m_cond.wait(lock, [this, i, window]() { return m_stop || i < m_written + window; });
+						if (m_stop)
+							return;
+					}
+					bool ok{ false };
+					try
+					{
+						ok = run(seg, m_flags);
+					}
+					catch (...)
+					{
+						std::lock_guard<std::mutex> lock(m_mutex);
+						if (!m_error)
+							m_error = std::current_exception();
+					}
+					{
+						std::lock_guard<std::mutex> lock(m_mutex);
+						seg.ok = ok;
+						seg.done = true;
+					}
+					m_cond.notify_all();
+				}
+			}
+			void stop()
+			{
+				{
+					std::lock_guard<std::mutex> lock(m_mutex);
+					m_stop = true;
+				}
+				m_cond.notify_all();
+				for (auto& worker : m_workers)
+					worker.join();
+				m_workers.clear();
+			}
+		};
+
+		std::ostream& operator<<(std::ostream& os, json_t* v)
+		{
+			if (!os)
+				throw Exc("JSON error: Output stream is not in a good state. Check permissions.");
+			ZJSON_TRACE_SCOPE(TraceOp::Dump);
+			const size_t threads{ size_t(os.iword(osParallelIdx())) };
+			size_t minNodes{ PARALLEL_DUMP_MIN_NODES };
+			if (1 < threads && 0 == os.iword(osCanonicalIdx()) && v && hasNodes(v, minNodes))
+			{
+				size_t outSize{ 0 };
+				const bool dumped{ ParallelDumper(osDumpFlags(os), unsigned(threads)).dump(v, os, outSize) };
+				if (dumped)
+					ZJSON_TRACE_DONE(outSize);
+				if (!dumped && 1 != os.iword(osIgnoreErrsIdx()))
+					throw Exc("JSON serialization failed (invalid UTF8 string?)");
+				return os;
+			}
+			std::string buf;
+			Dumper dumper(osDumpFlags(os), buf, &ostreamFlush, &os);
+			const bool dumped{ v && dumper.dump(v) };
+			dumper.flush();//whatever was dumped before any failure (same as jansson)
+			if (dumped)
+				ZJSON_TRACE_DONE(dumper.outputSize());
+
+			if (!dumped && 1 != os.iword(osIgnoreErrsIdx()))
+				throw Exc("JSON serialization failed (invalid UTF8 string?)");
+			return os;
+		}
+	}
+	namespace
+	{
+		//FIPS 180-4 SHA-256, fed by the Dumper flushes
+		class Sha256
+		{
+		public:
+			void update(const uint8_t* data, size_t sz)
+			{
+				m_bytes += sz;
+				while (0 != sz)
+				{
+					const size_t n{ std::min(sz, sizeof(m_block) - m_blockSz) };
+					memcpy(m_block + m_blockSz, data, n);
+					m_blockSz += n;
+					data += n;
+					sz -= n;
+					if (sizeof(m_block) == m_blockSz)
+					{
+						transform(m_block);
+						m_blockSz = 0;
+					}
+				}
+			}
+			std::array<uint8_t, 32> digest()
+			{
+				const uint64_t bits{ m_bytes * 8 };
+				const uint8_t pad{ 0x80 };
+				update(&pad, 1);
+				const uint8_t zero{ 0 };
+				while (56 != m_blockSz)
+					update(&zero, 1);
+				uint8_t len[8];
+				for (int i = 0; i != 8; ++i)
+					len[i] = uint8_t(bits >> (56 - 8 * i));
+				update(len, sizeof(len));
+				std::array<uint8_t, 32> ret;
+				for (size_t i = 0; i != 32; ++i)
+					ret[i] = uint8_t(m_state[i / 4] >> (24 - 8 * (i % 4)));
+				return ret;
+			}
+			static bool flush(std::string& buf, void* data)
+			{
+				((Sha256*)data)->update((const uint8_t*)buf.data(), buf.size());
+				buf.clear();
+				return true;
+			}
+
+		private:
+			uint32_t m_state[8]{ 0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a, 0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19 };
+			uint8_t m_block[64];
+			size_t m_blockSz{ 0 };
+			uint64_t m_bytes{ 0 };
+
+			static uint32_t rotr(uint32_t x, int n) { return (x >> n) | (x << (32 - n)); }
+			void transform(const uint8_t* block)
+			{
+				static const uint32_t K[64]{
+					0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+					0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+					0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+					0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+					0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+					0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+					0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+					0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2 };
+				uint32_t w[64];
+				for (int i = 0; i != 16; ++i)
+					w[i] = uint32_t(block[4 * i]) << 24 | uint32_t(block[4 * i + 1]) << 16 | uint32_t(block[4 * i + 2]) << 8 | block[4 * i + 3];
+				for (int i = 16; i != 64; ++i)
+				{
+					const uint32_t s0{ rotr(w[i - 15], 7) ^ rotr(w[i - 15], 18) ^ (w[i - 15] >> 3) };
+					const uint32_t s1{ rotr(w[i - 2], 17) ^ rotr(w[i - 2], 19) ^ (w[i - 2] >> 10) };
+					w[i] = w[i - 16] + s0 + w[i - 7] + s1;
+				}
+				uint32_t a{ m_state[0] }, b{ m_state[1] }, c{ m_state[2] }, d{ m_state[3] };
+				uint32_t e{ m_state[4] }, f{ m_state[5] }, g{ m_state[6] }, h{ m_state[7] };
+				for (int i = 0; i != 64; ++i)
+				{
+					const uint32_t t1{ h + (rotr(e, 6) ^ rotr(e, 11) ^ rotr(e, 25)) + ((e & f) ^ (~e & g)) + K[i] + w[i] };
+					const uint32_t t2{ (rotr(a, 2) ^ rotr(a, 13) ^ rotr(a, 22)) + ((a & b) ^ (a & c) ^ (b & c)) };
+					h = g;
+					g = f;
+					f = e;
+					e = d + t1;
+					d = c;
+					c = b;
+					b = a;
+					a = t1 + t2;
+				}
+				m_state[0] += a;
+				m_state[1] += b;
+				m_state[2] += c;
+				m_state[3] += d;
+				m_state[4] += e;
+				m_state[5] += f;
+				m_state[6] += g;
+				m_state[7] += h;
+			}
+		};
+	}
+
+	std::string toCanonicalString(const Value& val)
+	{
+		std::string buf;
+		Dumper dumper(JSON_COMPACT | DUMP_CANONICAL, buf);
+		if (val.isEmpty() || !dumper.dump(ValueRaw::get(val)))
+			throw Exc("JSON serialization failed (invalid UTF8 string?)");
+		return buf;
+	}
+
+	std::array<uint8_t, 32> canonicalSha256(const Value& val)
+	{
+		Sha256 sha;
+		std::string buf;
+		Dumper dumper(JSON_COMPACT | DUMP_CANONICAL, buf, &Sha256::flush, &sha);
+		if (val.isEmpty() || !dumper.dump(ValueRaw::get(val)) || !dumper.flush())
+			throw Exc("JSON serialization failed (invalid UTF8 string?)");
+		return sha.digest();
+	}
+
+	struct StreamWriter::Impl
+	{
+		struct Level
+		{
+			bool isObject;
+			bool empty;
+		};
+		std::string buf;//ostream output only
+		std::string& out;
+		Dumper dumper;
+		std::vector<Level> levels;
+		bool afterKey{ false };
+		bool rootDone{ false };
+
+		Impl(std::ostream& os) : out(buf), dumper(osDumpFlags(os), buf, &ostreamFlush, &os) {}
+		Impl(std::string& out_, size_t flags) : out(out_), dumper(flags, out_) {}
+
+		//in all builds: the cheap checks which keep the levels consistent
+		void require(bool ok, const char* msg) const
+		{
+			if (!ok)
+				throw Exc(std::string("JSON error: StreamWriter misuse: ") + msg);
+		}
+		void check(bool ok, const char* msg) const
+		{
+#if !defined(NDEBUG)
+			if (!ok)
+				throw Exc(std::string("JSON error: StreamWriter misuse: ") + msg);
+#else
+			(void)ok;
+			(void)msg;
+#endif
+		}
+		void separator()
+		{
+			Level& level = levels.back();
+			if (level.empty)
+			{
+				level.empty = false;
+				dumper.indent(levels.size(), false);
+			}
+			else
+			{
+				out += ',';
+				dumper.indent(levels.size(), true);
+			}
+		}
+		void beforeValue()
+		{
+			if (levels.empty())
+			{
+				check(!rootDone, "more than one root value");
+				rootDone = true;
+			}
+			else if (levels.back().isObject)
+			{
+				check(afterKey, "object value without key");
+				afterKey = false;
+			}
+			else
+				separator();
+		}
+		void begin(bool isObject)
+		{
+			beforeValue();
+			out += isObject ? '{' : '[';
+			levels.push_back({ isObject, true });
+		}
+		void end(bool isObject)
+		{
+			require(!levels.empty(), "end without begin");
+			check(isObject == levels.back().isObject, "end without matching begin");
+			check(!afterKey, "key without value");
+			const bool empty{ levels.back().empty };
+			levels.pop_back();
+			if (!empty)
+				dumper.indent(levels.size(), false);
+			out += isObject ? '}' : ']';
+			dumper.flushIfFull();
+		}
+		void checkDumped(bool dumped)
+		{
+			if (!dumped)
+				throw Exc("JSON serialization failed (invalid UTF8 string?)");
+			dumper.flushIfFull();
+		}
+	};
+
+	StreamWriter::StreamWriter(std::ostream& os)
+	{
+		if (!os)
+			throw Exc("JSON error: Output stream is not in a good state. Check permissions.");
+		m_impl.reset(new Impl{ os });
+	}
+
+	StreamWriter::StreamWriter(std::string& out, bool sortIt, int identSpaces)
+		: m_impl(new Impl{ out, size_t((0 == identSpaces ? JSON_COMPACT : JSON_INDENT(identSpaces)) | (sortIt ? JSON_SORT_KEYS : 0)) })
+	{}
+
+	StreamWriter::~StreamWriter()
+	{
+		flush();
+	}
+
+	void StreamWriter::flush()
+	{
+		m_impl->dumper.flush();
+	}
+
+	StreamWriter& StreamWriter::beginObject()
+	{
+		m_impl->begin(true);
+		return *this;
+	}
+
+	StreamWriter& StreamWriter::endObject()
+	{
+		m_impl->end(true);
+		return *this;
+	}
+
+	StreamWriter& StreamWriter::beginArray()
+	{
+		m_impl->begin(false);
+		return *this;
+	}
+
+	StreamWriter& StreamWriter::endArray()
+	{
+		m_impl->end(false);
+		return *this;
+	}
+
+	StreamWriter& StreamWriter::key(const char* key)
+	{
+		Impl& d = *m_impl;
+		d.require(!d.levels.empty(), "key outside of object");
+		d.check(d.levels.back().isObject && !d.afterKey, "key outside of object or after another key");
+		d.separator();
+		if (!d.dumper.dumpString(key, strlen(key)))
+			throw Exc("JSON serialization failed (invalid UTF8 string?)");
+		d.dumper.keySeparator();
+		d.afterKey = true;
+		return *this;
+	}
+
+	StreamWriter& StreamWriter::value(const Value& val)
+	{
+		if (val.isEmpty())
+			throw Exc("JSON error: StreamWriter can not write an empty value");
+		m_impl->beforeValue();
+		m_impl->checkDumped(m_impl->dumper.dump(ValueRaw::get(val), m_impl->levels.size()));
+		return *this;
+	}
+
+	StreamWriter& StreamWriter::value(const char* str)
+	{
+		m_impl->beforeValue();
+		m_impl->checkDumped(m_impl->dumper.dumpString(str, strlen(str)));
+		return *this;
+	}
+
+	StreamWriter& StreamWriter::value(const std::string& str)
+	{
+		m_impl->beforeValue();
+		m_impl->checkDumped(m_impl->dumper.dumpString(str.data(), str.size()));
+		return *this;
+	}
+
+	StreamWriter& StreamWriter::value(bool b)
+	{
+		m_impl->beforeValue();
+		b ? m_impl->out.append("true", 4) : m_impl->out.append("false", 5);
+		return *this;
+	}
+
+	StreamWriter& StreamWriter::value(double d)
+	{
+		m_impl->beforeValue();
+		if (!m_impl->dumper.dumpDouble(d))
+			throw Exc("JSON serialization failed (NaN or infinity)");
+		m_impl->dumper.flushIfFull();
+		return *this;
+	}
+
+	StreamWriter& StreamWriter::intValue(int64_t i)
+	{
+		m_impl->beforeValue();
+		m_impl->checkDumped(m_impl->dumper.dumpInt(i));
+		return *this;
+	}
+
+	StreamWriter& StreamWriter::uintValue(uint64_t u)
+	{
+		if (uint64_t(INT64_MAX) < u)
+			throw Exc("JSON error: integer out of range. Value " + std::to_string(u));
+		return intValue(int64_t(u));
+	}
+
+	StreamWriter& StreamWriter::null()
+	{
+		m_impl->beforeValue();
+		m_impl->out.append("null", 4);
+		return *this;
+	}
+
+	bool isValidUtf8(const char* str, size_t sz)
+	{
+		const uint8_t* s = (const uint8_t*)str;
+		size_t pos{ 0 };
+		while (pos != sz)
+		{
+			pos += asciiPrefix(s + pos, sz - pos);
+			if (pos == sz)
+				break;
+			const size_t seqLen{ utf8SeqLen(s + pos, sz - pos) };
+			if (0 == seqLen)
+				return false;
+			pos += seqLen;
+		}
+		return true;
+	}
+
+	bool hasValidUtf8(const Value& val)
+	{
+		json_t* v = ValueRaw::get(val);
+		switch (json_typeof(v))
+		{
+		case JSON_STRING: return isValidUtf8(json_string_value(v), json_string_length(v));
+		case JSON_ARRAY:
+			for (size_t i = 0, sz = json_array_size(v); i != sz; ++i)
+				if (!hasValidUtf8(Value(json_array_get(v, i))))
+					return false;
+			return true;
+		case JSON_OBJECT:
+			for (void* iter = json_object_iter(v); iter; iter = json_object_iter_next(v, iter))
+			{
+				const char* key = json_object_iter_key(iter);
+				if (!isValidUtf8(key, strlen(key)) || !hasValidUtf8(Value(json_object_iter_value(iter))))
+					return false;
+			}
+			return true;
+		default: return true;
+		}
+	}
+
+	struct Template::Impl
+	{
+		static const size_t NO_SLOT{ size_t(-1) };
+		struct Part
+		{
+			std::string text;//output before the slot
+			size_t slot{ NO_SLOT };
+			size_t depth{ 0 };
+		};
+		size_t flags{ 0 };
+		std::vector<Part> parts;
+		std::vector<std::string> names;
+
+		std::string& text() { return parts.back().text; }
+		size_t slotOf(const json_t* v)
+		{//"{{name}}" string values
+			const char* str = json_string_value(v);
+			const size_t sz{ json_string_length(v) };
+			if (5 > sz || 0 != strncmp(str, "{{", 2) || 0 != strcmp(str + sz - 2, "}}"))
+				return NO_SLOT;
+			const std::string name(str + 2, sz - 4);
+			const auto it = std::find(names.begin(), names.end(), name);
+			if (it != names.end())
+				return size_t(it - names.begin());
+			names.push_back(name);
+			return names.size() - 1;
+		}
+		void compile(const json_t* v, size_t depth)
+		{//same output as the Dumper, split at the slots
+			if (json_is_string(v))
+			{
+				const size_t slot{ slotOf(v) };
+				if (NO_SLOT != slot)
+				{
+					parts.back().slot = slot;
+					parts.back().depth = depth;
+					parts.emplace_back();
+					return;
+				}
+			}
+			if (!json_is_object(v) && !json_is_array(v))
+			{
+				if (!Dumper(flags, text()).dump(v, depth))
+					throw Exc("JSON serialization failed (invalid UTF8 string?)");
+				return;
+			}
+			const bool isObject{ json_is_object(v) };
+			const size_t sz{ isObject ? json_object_size(v) : json_array_size(v) };
+			std::vector<const char*> keys;
+			if (isObject)
+			{
+				json_t* obj = const_cast<json_t*>(v);
+				for (void* iter = json_object_iter(obj); iter; iter = json_object_iter_next(obj, iter))
+					keys.push_back(json_object_iter_key(iter));
+				if (flags & JSON_SORT_KEYS)
+					std::sort(keys.begin(), keys.end(), [](const char* lhs, const char* rhs) { return 0 > strcmp(lhs, rhs); });
+			}
+			text() += isObject ? '{' : '[';
+			if (0 != sz)
+				Dumper(flags, text()).indent(depth + 1, false);
+			for (size_t i = 0; i != sz; ++i)
+			{
+				if (isObject)
+				{
+					Dumper dumper(flags, text());
+					if (!dumper.dumpString(keys[i], strlen(keys[i])))
+						throw Exc("JSON serialization failed (invalid UTF8 string?)");
+					dumper.keySeparator();
+				}
+				compile(isObject ? json_object_get(v, keys[i]) : json_array_get(v, i), depth + 1);
+				if (i + 1 != sz)
+				{
+					text() += ',';
+					Dumper(flags, text()).indent(depth + 1, true);
+				}
+				else
+					Dumper(flags, text()).indent(depth, false);
+			}
+			text() += isObject ? '}' : ']';
+		}
+	};
+
+	Template::Template(const Value& proto, bool sortIt /*= false*/, int identSpaces /*= 0*/)
+	{
+		auto impl = std::make_shared<Impl>();
+		impl->flags = (0 == identSpaces ? JSON_COMPACT : JSON_INDENT(identSpaces)) | (sortIt ? JSON_SORT_KEYS : 0);
+		impl->parts.emplace_back();
+		if (!proto.isEmpty())
+			impl->compile(ValueRaw::get(proto), 0);
+		m_impl = std::move(impl);
+	}
+
+	size_t Template::slotCount() const
+	{
+		return m_impl->names.size();
+	}
+
+	size_t Template::slot(const char* name) const
+	{
+		const auto it = std::find(m_impl->names.begin(), m_impl->names.end(), name);
+		if (it == m_impl->names.end())
+			throw Exc(std::string("JSON error: Unknown template slot: ") + name);
+		return size_t(it - m_impl->names.begin());
+	}
+
+	const std::string& Template::slotName(size_t idx) const
+	{
+		return m_impl->names.at(idx);
+	}
+
+	void Template::render(std::string& out, const std::vector<Value>& values) const
+	{
+		if (values.size() < m_impl->names.size())
+			throw Exc("JSON error: Template values missing");
+		size_t sz{ out.size() };
+		for (const Impl::Part& part : m_impl->parts)
+			sz += part.text.size();
+		out.reserve(sz);
+		Dumper dumper(m_impl->flags, out);
+		for (const Impl::Part& part : m_impl->parts)
+		{
+			out += part.text;
+			if (Impl::NO_SLOT == part.slot)
+				continue;
+			const Value& val = values[part.slot];
+			if (val.isEmpty())
+				throw Exc("JSON error: Template slot not set: " + m_impl->names[part.slot]);
+			if (!dumper.dump(ValueRaw::get(val), part.depth))
+				throw Exc("JSON serialization failed (invalid UTF8 string?)");
+		}
+	}
+
+	std::string Template::render(std::initializer_list<std::pair<const char*, Value>> values) const
+	{
+		std::vector<Value> vals(m_impl->names.size());
+		for (const auto& el : values)
+			vals[slot(el.first)] = el.second;
+		std::string ret;
+		render(ret, vals);
+		return ret;
+	}
+
+	std::ostream& operator<<(std::ostream& os, const Array& arrVal)
+	{
+		return os << arrVal.m_val;
+	}
+
+	std::ostream& operator<<(std::ostream& os, const Object& objVal)
+	{
+		return os << objVal.m_val;
+	}
+
+	namespace
+	{
+		[[noreturn]] void throwLoadErr(const json_error_t& err)
+		{
+			std::ostringstream os;
+			os << "JSON error: Deserialization failure (line "
+				<< err.line << ", clm " << err.column << ", pos " << err.position << "). "
+				<< err.text;
+			throw Exc(os.str());
+		}
+
+		struct IStreamSource
+		{
+			std::istream& is;
+			size_t bytes;
+		};
+
+		size_t istream_callback(void* buffer, size_t buflen, void* data)
+		{
+			IStreamSource& src = *(IStreamSource*)data;
+			std::istream& is = src.is;
+			if (!is.good())
+			{
+				if (is.eof())
+					return 0;
+				else
+					return (size_t)-1;
+			}
+			is.read((char*)buffer, buflen);
+			src.bytes += size_t(is.gcount());
+			return size_t(is.gcount());
+		}
+
+		std::istream& operator>>(std::istream& is, json_t*& v)
+		{
+			if (!is)
+				throw Exc("JSON error: Input stream is not in a good state. Check existence and permissions.");
+			json_decref(v);//first clean any previous values (if any)
+			ZJSON_TRACE_SCOPE(TraceOp::Parse);
+			json_error_t err;
+			IStreamSource src{ is, 0 };
+			v = json_load_callback(istream_callback, &src, 0/*JSON_DISABLE_EOF_CHECK*/, &err);
+			if (NULL == v)
+				throwLoadErr(err);
+			ZJSON_TRACE_DONE(src.bytes);
+			return is;
+		}
+	}
+
+	std::istream& operator>>(std::istream& is, Array& arrVal)
+	{
+		is >> arrVal.m_val;
+		if (!json_is_array(arrVal.m_val))
+			throw Exc(std::string("JSON error: Deserialization failure: Expecting array but deserialized ") + arrVal.type2String());
+
+		return is;
+	}
+
+	std::istream& operator>>(std::istream& is, Object& objVal)
+	{
+		is >> objVal.m_val;
+		if (!json_is_object(objVal.m_val))
+			throw Exc(std::string("JSON error: Deserialization failure: Expecting object but deserialized ") + objVal.type2String());
+
+		return is;
+	}
+
+	struct ElementReader::Impl
+	{
+		static const size_t READ_SIZE{ 64 * 1024 };
+		static const size_t NO_MARK{ size_t(-1) };
+		std::istream& is;
+		std::string buf;//from the start of the element being read (or the read position)
+		size_t pos{ 0 };//in buf
+		size_t mark{ NO_MARK };//element start in buf
+		size_t base{ 0 };//stream position of buf[0]
+		size_t line{ 1 };
+		size_t lineStart{ 0 };//stream position
+		std::string key;
+		char close{ 0 };//']' or '}' once the top-level value is opened
+		bool done{ false };
+
+		explicit Impl(std::istream& is_) : is(is_) {}
+
+		int peek()
+		{
+			if (pos == buf.size() && !read())
+				return EOF;
+			return (unsigned char)buf[pos];
+		}
+		void take()
+		{
+			if ('\n' == buf[pos])
+			{
+				++line;
+				lineStart = base + pos + 1;
+			}
+			++pos;
+		}
+		void skipWs()
+		{
+			for (int c = peek(); ' ' == c || '\t' == c || '\n' == c || '\r' == c; c = peek())
+				take();
+		}
+		bool read()
+		{//drops what was read before the element start
+			const size_t keep{ NO_MARK != mark ? mark : pos };
+			buf.erase(0, keep);
+			base += keep;
+			pos -= keep;
+			if (NO_MARK != mark)
+				mark = 0;
+			if (!is.good())
+			{
+				if (!is.eof())
+					throw Exc("JSON error: Input stream is not in a good state. Check existence and permissions.");
+				return false;
+			}
+			const size_t sz{ buf.size() };
+			buf.resize(sz + READ_SIZE);
+			is.read(&buf[sz], std::streamsize(READ_SIZE));
+			buf.resize(sz + size_t(is.gcount()));
+			if (is.bad())
+				throw Exc("JSON error: Input stream is not in a good state. Check existence and permissions.");
+			return 0 != is.gcount();
+		}
+		[[noreturn]] void fail(const char* expected)
+		{
+			const int c{ peek() };
+			json_error_t err{};//positions after the unexpected character (same as jansson)
+			err.line = int(line);
+			err.column = int(base + pos - lineStart + (EOF == c ? 0 : 1));
+			err.position = int(base + pos + (EOF == c ? 0 : 1));
+			if (EOF == c)
+				snprintf(err.text, sizeof(err.text), "%s near end of file", expected);
+			else
+				snprintf(err.text, sizeof(err.text), "%s near '%c'", expected, char(c));
+			throwLoadErr(err);
+		}
+		json_t* load(size_t startLine, size_t startColumn)
+		{//parses buf[mark, pos)
+			const size_t startPos{ base + mark };
+			json_error_t err;
+			json_t* v = json_loadb(buf.data() + mark, pos - mark, JSON_DECODE_ANY, &err);
+			mark = NO_MARK;
+			if (!v)
+			{//positions in the whole stream
+				if (1 >= err.line)
+					err.column += int(startColumn - 1);
+				err.line += int(startLine - 1);
+				err.position += int(startPos);
+				throwLoadErr(err);
+			}
+			return v;
+		}
+		json_t* scanValue()
+		{//finds the end of the value (the parser reports any invalid content in it)
+			const size_t startLine{ line }, startColumn{ base + pos - lineStart + 1 };
+			mark = pos;
+			std::string closers;
+			bool inString{ false };
+			bool escape{ false };
+			for (int c = peek(); EOF != c; c = peek())
+			{
+				if (inString)
+				{
+					take();
+					if (escape)
+						escape = false;
+					else if ('\\' == c)
+						escape = true;
+					else if ('"' == c)
+					{
+						inString = false;
+						if (closers.empty())
+							break;
+					}
+					continue;
+				}
+				if ('"' == c)
+					inString = true;
+				else if ('[' == c || '{' == c)
+					closers += ('[' == c ? ']' : '}');
+				else if (']' == c || '}' == c)
+				{
+					if (closers.empty())
+						break;
+					const bool matches{ closers.back() == c };
+					closers.pop_back();
+					if (!matches || closers.empty())
+					{
+						take();
+						break;
+					}
+				}
+				else if (closers.empty() && (',' == c || ' ' == c || '\t' == c || '\n' == c || '\r' == c))
+					break;
+				take();
+			}
+			if (mark == pos && EOF != peek())
+				take();//e.g. the ']' of "[1,]" for the parser to report it
+			return load(startLine, startColumn);
+		}
+		void readKey()
+		{
+			if ('"' != peek())
+				fail("string or '}' expected");
+			const size_t startLine{ line }, startColumn{ base + pos - lineStart + 1 };
+			mark = pos;
+			take();
+			bool escape{ false };
+			for (int c = peek(); EOF != c; c = peek())
+			{
+				take();
+				if (escape)
+					escape = false;
+				else if ('\\' == c)
+					escape = true;
+				else if ('"' == c)
+					break;
+			}
+			json_t* v = load(startLine, startColumn);
+			key.assign(json_string_value(v), json_string_length(v));
+			json_decref(v);
+			skipWs();
+			if (':' != peek())
+				fail("':' expected");
+			take();
+			skipWs();
+		}
+		bool finish()
+		{//only whitespace may follow (same as the stream operators)
+			done = true;
+			skipWs();
+			if (EOF != peek())
+				fail("end of file expected");
+			return false;
+		}
+		bool next(Value& val)
+		{
+			if (done)
+				return false;
+			skipWs();
+			if (0 == close)
+			{
+				const int c{ peek() };
+				if ('[' != c && '{' != c)
+					fail("'[' or '{' expected");
+				close = ('[' == c ? ']' : '}');
+				take();
+				skipWs();
+				if (close == peek())
+				{
+					take();
+					return finish();
+				}
+			}
+			else
+			{
+				const int c{ peek() };
+				if (close == c)
+				{
+					take();
+					return finish();
+				}
+				if (',' != c)
+					fail(']' == close ? "']' expected" : "'}' expected");
+				take();
+				skipWs();
+			}
+			if ('}' == close)
+				readKey();
+			val = ValueRaw::steal(scanValue());
+			return true;
+		}
+	};
+
+	ElementReader::ElementReader(std::istream& is)
+		: m_impl(new Impl(is))
+	{
+		if (!is)
+			throw Exc("JSON error: Input stream is not in a good state. Check existence and permissions.");
+	}
+
+	ElementReader::~ElementReader() = default;
+
+	bool ElementReader::next(Value& val)
+	{
+		return m_impl->next(val);
+	}
+
+	const std::string& ElementReader::key() const
+	{
+		return m_impl->key;
+	}
+
+	bool ElementReader::isObject() const
+	{
+		return '}' == m_impl->close;
+	}
+
+	namespace
+	{
+		//Structure events of StructScanner (e.g. for validation while parsing). Return false to stop.
+		class ScanHandler
+		{
+		public:
+			virtual ~ScanHandler() {}
+			//a value starts (first char: '{', '[', '"' or the first char of a number, true, false or null)
+			virtual bool onValue(char first) = 0;
+			//object key, as in the input (i.e. escaped)
+			virtual bool onKey(const char* key, size_t sz) = 0;
+			//the last started array or object ended
+			virtual bool onEnd() = 0;
+		};
+
+		//Incremental scan of the JSON structure (not validating, the parser does that): nesting, strings and elements.
+		//Checks the ParseLimits, with DOM bytes estimated as in Value::memoryUsage().
+		class StructScanner
+		{
+		public:
+			explicit StructScanner(const ParseLimits& limits, ScanHandler* handler = nullptr) : m_limits(limits), m_handler(handler) {}
+			//false as soon as a limit is exceeded
+			bool feed(const char* data, size_t sz)
+			{
+				for (size_t i = 0; i != sz; ++i, ++m_pos)
+				{
+					const char c{ data[i] };
+					if (m_inString)
+					{
+						size_t decoded{ 0 };//bytes of the parsed string
+						if (0 != m_hexLeft)
+						{//\uXXXX: its UTF8 bytes counted at the last digit (2 per surrogate, i.e. 4 per pair)
+							m_cp = (m_cp << 4) | uint32_t('9' >= c ? c - '0' : (c | 0x20) - 'a' + 10);
+							if (0 == --m_hexLeft)
+								decoded = 0x80 > m_cp ? 1 : 0x800 > m_cp || (0xD800 <= m_cp && 0xDFFF >= m_cp) ? 2 : 3;
+						}
+						else if (m_escape)
+						{
+							m_escape = false;
+							if ('u' == c)
+							{
+								m_hexLeft = 4;
+								m_cp = 0;
+							}
+							else
+								decoded = 1;
+						}
+						else if ('\\' == c)
+							m_escape = true;
+						else if ('"' == c)
+						{
+							m_inString = false;
+							if (!addBytes(m_strLen + (m_isKey ? KEY_BYTES : STRING_BYTES)))
+								return false;
+							if (m_handler && m_isKey && !m_handler->onKey(m_key.data(), m_key.size()))
+								return fail(Errc::Invalid);
+							continue;
+						}
+						else
+							decoded = 1;
+						if (m_handler && m_isKey)
+							m_key += c;
+						if (0 == decoded)
+							continue;
+						m_strLen += decoded;
+						if (0 != m_limits.maxStringLength && m_limits.maxStringLength < m_strLen)
+							return fail(Errc::StringTooLong);
+						if (0 != m_limits.maxBytes && m_limits.maxBytes - m_bytes < m_strLen)
+							return fail(Errc::TooLarge);//before the end of a huge string
+						continue;
+					}
+					switch (c)
+					{
+					case ' ': case '\t': case '\n': case '\r':
+						m_inToken = false;
+						break;
+					case '{': case '[':
+						m_inToken = false;
+						if (!element() || !handlerValue(c))
+							return false;
+						if (0 != m_limits.maxDepth && m_limits.maxDepth <= m_levels.size())
+							return fail(Errc::TooDeep);
+						m_levels.push_back({ '{' == c, '{' == c, 0 });
+						if (!addBytes('{' == c ? OBJECT_BYTES : ARRAY_BYTES))
+							return false;
+						break;
+					case '}': case ']':
+						m_inToken = false;
+						if (!m_levels.empty())
+						{
+							m_levels.pop_back();
+							if (m_handler && !m_handler->onEnd())
+								return fail(Errc::Invalid);
+						}
+						break;
+					case ',':
+						m_inToken = false;
+						if (!m_levels.empty() && m_levels.back().isObject)
+							m_levels.back().expectKey = true;
+						break;
+					case ':':
+						m_inToken = false;
+						if (!m_levels.empty())
+							m_levels.back().expectKey = false;
+						break;
+					case '"':
+						m_inToken = false;
+						m_inString = true;
+						m_strLen = 0;
+						m_isKey = !m_levels.empty() && m_levels.back().expectKey;
+						if (m_isKey)
+							m_key.clear();
+						if (!(m_isKey ? key() : element() && handlerValue(c)))
+							return false;
+						break;
+					default://number, true, false or null
+						if (!m_inToken)
+						{
+							m_inToken = true;
+							if (!element() || !handlerValue(c) || ('t' != c && 'f' != c && 'n' != c && !addBytes(NUMBER_BYTES)))
+								return false;
+						}
+					}
+				}
+				return true;
+			}
+			Errc error() const { return m_err; }
+			size_t errorPos() const { return m_errPos; }
+
+		private:
+			//jansson 2.14 (64 bit) struct sizes, container growth amortized
+			static const size_t OBJECT_BYTES{ 72 + 16 * 8 };
+			static const size_t KEY_BYTES{ 57 + 16 };
+			static const size_t ARRAY_BYTES{ 40 + 8 * 8 };
+			static const size_t ARRAY_SLOT_BYTES{ 16 };
+			static const size_t STRING_BYTES{ 33 };
+			static const size_t NUMBER_BYTES{ 24 };
+			struct Level
+			{
+				bool isObject;
+				bool expectKey;
+				size_t count;
+			};
+			const ParseLimits m_limits;
+			ScanHandler* const m_handler;
+			std::vector<Level> m_levels;
+			std::string m_key;//for the handler only
+			size_t m_pos{ 0 };
+			size_t m_bytes{ 0 };
+			size_t m_strLen{ 0 };
+			bool m_inString{ false };
+			bool m_escape{ false };
+			unsigned m_hexLeft{ 0 };//of a \u escape
+			uint32_t m_cp{ 0 };
+			bool m_isKey{ false };
+			bool m_inToken{ false };
+			Errc m_err{ Errc::Ok };
+			size_t m_errPos{ 0 };
+
+			bool fail(Errc err)
+			{
+				m_err = err;
+				m_errPos = m_pos;
+				return false;
+			}
+			bool handlerValue(char first) { return !m_handler || m_handler->onValue(first) || fail(Errc::Invalid); }
+			bool addBytes(size_t bytes)
+			{
+				m_bytes += bytes;
+				return 0 == m_limits.maxBytes || m_limits.maxBytes >= m_bytes || fail(Errc::TooLarge);
+			}
+			bool element()
+			{//object values are counted by their keys
+				if (m_levels.empty() || m_levels.back().isObject)
+					return true;
+				const size_t count{ ++m_levels.back().count };
+				if (0 != m_limits.maxElements && m_limits.maxElements < count)
+					return fail(Errc::TooManyElements);
+				return addBytes(ARRAY_SLOT_BYTES);
+			}
+			bool key()
+			{
+				const size_t count{ ++m_levels.back().count };
+				if (0 != m_limits.maxKeys && m_limits.maxKeys < count)
+					return fail(Errc::TooManyKeys);
+				if (0 != m_limits.maxElements && m_limits.maxElements < count)
+					return fail(Errc::TooManyElements);
+				return true;
+			}
+		};
+
+		struct ScannedSource
+		{
+			const char* data;
+			size_t sz;
+			size_t pos;
+			StructScanner scanner;
+		};
+
+		size_t scannedSourceCallback(void* buffer, size_t buflen, void* data)
+		{
+			ScannedSource& src = *(ScannedSource*)data;
+			const size_t ret{ std::min(buflen, src.sz - src.pos) };
+			memcpy(buffer, src.data + src.pos, ret);
+			if (!src.scanner.feed(src.data + src.pos, ret))
+				return size_t(-1);
+			src.pos += ret;
+			return ret;
+		}
+
+		Error parseErr(const json_error_t& err)
+		{
+			Error ret;
+#if 0x020b00 <= JANSSON_VERSION_HEX
+			switch (json_error_code(&err))
+			{
+			case json_error_premature_end_of_input: ret.code = Errc::PrematureEnd; break;
+			case json_error_invalid_utf8: ret.code = Errc::InvalidUtf8; break;
+			case json_error_numeric_overflow: ret.code = Errc::NumberOutOfRange; break;
+			case json_error_stack_overflow: ret.code = Errc::TooDeep; break;
+			case json_error_out_of_memory: ret.code = Errc::OutOfMemory; break;
+			default: ret.code = Errc::Syntax;
+			}
+#else//no error codes before jansson 2.11: same mapping from the messages
+			const auto has = [&err](const char* msg) { return nullptr != strstr(err.text, msg); };
+			if (has("premature end of input") || has("near end of file"))
+				ret.code = Errc::PrematureEnd;
+			else if (has("unable to decode byte") || has("Invalid UTF-8"))
+				ret.code = Errc::InvalidUtf8;
+			else if (has("too big") || has("overflow"))
+				ret.code = Errc::NumberOutOfRange;
+			else if (has("maximum parsing depth"))
+				ret.code = Errc::TooDeep;
+			else if (has("out of memory"))
+				ret.code = Errc::OutOfMemory;
+			else
+				ret.code = Errc::Syntax;
+#endif
+			ret.line = err.line;
+			ret.column = err.column;
+			ret.position = size_t(0 > err.position ? 0 : err.position);
+			return ret;
+		}
+
+		[[noreturn]] void throwParseErr(const Error& err)
+		{
+			std::ostringstream os;
+			os << "JSON error: Deserialization failure (line "
+				<< err.line << ", clm " << err.column << ", pos " << err.position << "). " << err.what();
+			throw Exc(os.str());
+		}
+	}
+
+	namespace
+	{
+		const size_t PARALLEL_MIN_BYTES{ 1024 * 1024 };//smaller inputs (or members) are parsed serially
+		const size_t PARALLEL_MIN_CHUNK{ 64 * 1024 };
+		const int PARALLEL_MAX_NESTING{ 4 };//levels of big members split
+
+		typedef std::pair<const char*, const char*> Range;
+
+		const char* skipWs(const char* p, const char* end)
+		{
+			while (p != end && (' ' == *p || '\t' == *p || '\n' == *p || '\r' == *p))
+				++p;
+			return p;
+		}
+
+		//Top level elements (object members) of the array/object starting at open. The closing bracket or nullptr if malformed
+		//(the elements are checked by their parsing, but this level is rebuilt with its own brackets)
+		const char* scanElements(const char* open, const char* end, std::vector<Range>& elems)
+		{
+			size_t depth{ 0 };
+			const char* elemStart = open + 1;
+			for (const char* p = open; p != end; ++p)
+			{
+				switch (*p)
+				{
+				case '"':
+					for (++p; p != end && '"' != *p; ++p)
+						if ('\\' == *p && ++p == end)
+							return nullptr;
+					if (p == end)
+						return nullptr;
+					break;
+				case '[': case '{':
+					++depth;
+					break;
+				case ']': case '}':
+					if (0 == --depth)
+					{
+						if (('[' == *open) != (']' == *p))
+							return nullptr;//mismatched closing bracket
+						if (skipWs(elemStart, p) != p)
+							elems.emplace_back(elemStart, p);
+						else if (!elems.empty())
+							return nullptr;//trailing comma
+						return p;
+					}
+					break;
+				case ',':
+					if (1 == depth)
+					{
+						if (skipWs(elemStart, p) == p)
+							return nullptr;
+						elems.emplace_back(elemStart, p);
+						elemStart = p + 1;
+					}
+					break;
+				}
+			}
+			return nullptr;
+		}
+
+		//Value start of an object member ("key": value), nullptr if malformed
+		const char* memberValue(const Range& member)
+		{
+			const char* p = skipWs(member.first, member.second);
+			if (p == member.second || '"' != *p)
+				return nullptr;
+			for (++p; p != member.second && '"' != *p; ++p)
+				if ('\\' == *p && ++p == member.second)
+					return nullptr;
+			if (p == member.second)
+				return nullptr;
+			p = skipWs(p + 1, member.second);
+			return p != member.second && ':' == *p ? skipWs(p + 1, member.second) : nullptr;
+		}
+
+		class ParallelParser
+		{
+		public:
+			ParallelParser(size_t chunkSz) : m_chunkSz(chunkSz) {}
+			~ParallelParser()
+			{
+				for (Task& task : m_tasks)
+					json_decref(task.result);
+			}
+			//false if malformed (left to the serial parsing, for the same error)
+			bool plan(const char* open, const char* end)
+			{
+				const char* close = planLevel(m_root, open, end, PARALLEL_MAX_NESTING);
+				return close && skipWs(close + 1, end) == end && 1 < m_tasks.size();
+			}
+			size_t tasks() const { return m_tasks.size(); }
+			bool run(unsigned threads)
+			{
+				std::atomic<size_t> next{ 0 };
+				std::atomic<bool> failed{ false };
+				auto worker = [this, &next, &failed]()
+				{
+					for (size_t i = next++; i < m_tasks.size() && !failed; i = next++)
+					{
+						Task& task = m_tasks[i];
+						json_error_t err;
+						task.result = json_load_callback(&piecesCallback, &task, 0, &err);
+						if (!task.result)
+							failed = true;
+					}
+				};
+				std::vector<std::thread> workers;
+				for (unsigned i = 1; i < threads; ++i)
+					workers.emplace_back(worker);
+				worker();
+				for (std::thread& t : workers)
+					t.join();
+				return !failed;
+			}
+			json_t* build() { return build(m_root); }
+
+		private:
+			struct Task
+			{
+				const char* pieces[3];//prefix, input range, suffix
+				size_t sizes[3];
+				size_t idx;
+				size_t pos;
+				json_t* result;
+			};
+			struct Level;
+			struct Part
+			{
+				size_t task;//elements group or the key of a nested member (NO_TASK for nested array elements)
+				std::unique_ptr<Level> nested;
+			};
+			struct Level
+			{
+				bool isObject{ false };
+				std::vector<Part> parts;
+			};
+			static const size_t NO_TASK{ size_t(-1) };
+			const size_t m_chunkSz;
+			std::vector<Task> m_tasks;
+			Level m_root;
+
+			static size_t piecesCallback(void* buffer, size_t buflen, void* data)
+			{
+				Task& task = *(Task*)data;
+				size_t ret{ 0 };
+				while (ret != buflen && 3 != task.idx)
+				{
+					const size_t sz{ std::min(buflen - ret, task.sizes[task.idx] - task.pos) };
+					memcpy((char*)buffer + ret, task.pieces[task.idx] + task.pos, sz);
+					ret += sz;
+					task.pos += sz;
+					if (task.sizes[task.idx] == task.pos)
+					{
+						++task.idx;
+						task.pos = 0;
+					}
+				}
+				return ret;
+			}
+			size_t addTask(const char* prefix, const char* begin, const char* end, const char* suffix)
+			{
+				m_tasks.push_back({ { prefix, begin, suffix }, { strlen(prefix), size_t(end - begin), strlen(suffix) }, 0, 0, nullptr });
+				return m_tasks.size() - 1;
+			}
+			const char* planLevel(Level& level, const char* open, const char* end, int nesting)
+			{
+				std::vector<Range> elems;
+				const char* close = scanElements(open, end, elems);
+				if (!close)
+					return nullptr;
+				level.isObject = '{' == *open;
+				const char* prefix = level.isObject ? "{" : "[";
+				const char* suffix = level.isObject ? "}" : "]";
+				const size_t levelSz{ size_t(close - open) };
+				const char* groupStart = nullptr;
+				const char* groupEnd = nullptr;
+				for (const Range& elem : elems)
+				{
+					const size_t elemSz{ size_t(elem.second - elem.first) };
+					const char* value = level.isObject ? memberValue(elem) : skipWs(elem.first, elem.second);
+					if (!value)
+						return nullptr;
+					if (0 < nesting && PARALLEL_MIN_BYTES <= elemSz && levelSz / 2 <= elemSz && ('[' == *value || '{' == *value))
+					{//big member: split it too
+						if (groupStart)
+							level.parts.push_back({ addTask(prefix, groupStart, groupEnd, suffix), nullptr });
+						groupStart = nullptr;
+						Part part{ level.isObject ? addTask("{", elem.first, value, "0}") : NO_TASK, std::unique_ptr<Level>(new Level) };
+						const char* nestedClose = planLevel(*part.nested, value, elem.second, nesting - 1);
+						if (!nestedClose || skipWs(nestedClose + 1, elem.second) != elem.second)
+							return nullptr;
+						level.parts.push_back(std::move(part));
+						continue;
+					}
+					if (!groupStart)
+						groupStart = elem.first;
+					groupEnd = elem.second;
+					if (m_chunkSz <= size_t(groupEnd - groupStart))
+					{
+						level.parts.push_back({ addTask(prefix, groupStart, groupEnd, suffix), nullptr });
+						groupStart = nullptr;
+					}
+				}
+				if (groupStart)
+					level.parts.push_back({ addTask(prefix, groupStart, groupEnd, suffix), nullptr });
+				return close;
+			}
+			json_t* build(const Level& level)
+			{//same as the serial parsing: json_object_update() replaces duplicate keys values in place
+				json_t* ret = level.isObject ? json_object() : json_array();
+				for (const Part& part : level.parts)
+				{
+					if (part.nested)
+					{
+						json_t* child = build(*part.nested);
+						if (level.isObject)
+							json_object_set_new(ret, json_object_iter_key(json_object_iter(m_tasks[part.task].result)), child);
+						else
+							json_array_append_new(ret, child);
+					}
+					else if (level.isObject)
+						json_object_update(ret, m_tasks[part.task].result);
+					else
+						json_array_extend(ret, m_tasks[part.task].result);
+				}
+				return ret;
+			}
+		};
 	}
 
-	std::istream& operator>>(std::istream& is, Object& objVal)
+	Value parseParallel(const char* cStr, size_t sz, unsigned threads)
 	{
-		is >> objVal.m_val;
-		if (!json_is_object(objVal.m_val))
-			throw Exc(std::string("JSON error: Deserialization failure: Expecting object but deserialized ") + objVal.type2String());
+		if (0 == threads)
+			threads = std::max(1u, std::thread::hardware_concurrency());
+		const char* end = cStr + sz;
+		const char* open = skipWs(cStr, end);
+		if (1 < threads && PARALLEL_MIN_BYTES <= sz && open != end && ('[' == *open || '{' == *open))
+		{
+			ZJSON_TRACE_SCOPE(TraceOp::Parse);
+			json_decref(json_object());//hash seed initialized before the threads
+			ParallelParser parser{ std::max(PARALLEL_MIN_CHUNK, sz / (4 * threads)) };
+			if (parser.plan(open, end) && parser.run(unsigned(std::min<size_t>(threads, parser.tasks()))))
+			{
+				ZJSON_TRACE_DONE(sz);
+				return ValueRaw::steal(parser.build());
+			}
+		}
+		json_error_t err;//serial (also for the errors)
+		json_t* v = json_loadb(cStr, sz, 0, &err);
+		if (NULL == v)
+			throwLoadErr(err);
+		return ValueRaw::steal(v);
+	}
 
-		return is;
+	Expected<Value> tryParse(const char* cStr, size_t sz)
+	{
+		ZJSON_TRACE_SCOPE(TraceOp::Parse);
+		json_error_t err;
+		json_t* v = json_loadb(cStr, sz, 0, &err);
+		if (NULL == v)
+			return parseErr(err);
+		ZJSON_TRACE_DONE(sz);
+		return ValueRaw::steal(v);
+	}
+
+	namespace
+	{
+		Expected<Value> scannedParse(const char* cStr, size_t sz, const ParseLimits& limits, ScanHandler* handler)
+		{
+			ZJSON_TRACE_SCOPE(TraceOp::Parse);
+			json_error_t err;
+			ScannedSource src{ cStr, sz, 0, StructScanner{ limits, handler } };
+			json_t* v = json_load_callback(&scannedSourceCallback, &src, 0, &err);
+			if (NULL == v)
+			{
+				if (Errc::Ok == src.scanner.error())
+					return parseErr(err);
+				Error ret;
+				ret.code = src.scanner.error();
+				ret.position = src.scanner.errorPos();
+				return ret;
+			}
+			ZJSON_TRACE_DONE(sz);
+			return ValueRaw::steal(v);
+		}
+	}
+
+	Expected<Value> tryParse(const char* cStr, size_t sz, const ParseLimits& limits)
+	{
+		return scannedParse(cStr, sz, limits, nullptr);
+	}
+
+	Object strToObject(const char* cStr, size_t sz, const ParseLimits& limits)
+	{
+		const Expected<Value> ret{ tryParse(cStr, sz, limits) };
+		if (!ret)
+			throwParseErr(ret.error());
+		return ret->asObject();//throws if not an object
+	}
+
+	Array strToArray(const char* cStr, size_t sz, const ParseLimits& limits)
+	{
+		const Expected<Value> ret{ tryParse(cStr, sz, limits) };
+		if (!ret)
+			throwParseErr(ret.error());
+		return ret->asArray();//throws if not an array
+	}
+
+	struct Schema::Impl
+	{
+		static const size_t ANY{ size_t(-1) };//node index of the schemas accepting anything
+		enum : uint8_t { T_NULL = 1, T_BOOL = 2, T_INTEGER = 4, T_NUMBER = 8, T_STRING = 16, T_ARRAY = 32, T_OBJECT = 64, T_ALL = 127 };
+		struct Property
+		{
+			std::string key;
+			uint64_t hash;
+			size_t node;
+			bool required;
+		};
+		struct Node
+		{
+			uint8_t types{ T_ALL };
+			bool hasEnum{ false };
+			std::vector<Value> enumVals;
+			//object
+			std::vector<Property> props;
+			std::vector<uint32_t> propTable;//open addressing: props index + 1 (0 for free), power of 2 size
+			size_t requiredCnt{ 0 };
+			bool additional{ true };
+			size_t additionalNode{ ANY };
+			size_t minProps{ 0 };
+			size_t maxProps{ size_t(-1) };
+			//array
+			size_t items{ ANY };
+			size_t minItems{ 0 };
+			size_t maxItems{ size_t(-1) };
+			//number
+			bool hasMin{ false };
+			bool hasMax{ false };
+			bool exclMin{ false };
+			bool exclMax{ false };
+			double min{ 0 };
+			double max{ 0 };
+			//string
+			size_t minLength{ 0 };
+			size_t maxLength{ size_t(-1) };
+			std::shared_ptr<const std::regex> pattern;
+			//checks left to validate() after the streaming ones, in the node or its subtree (see markRescan())
+			bool rescan{ false };
+			bool childRescan{ false };
+		};
+		std::vector<Node> nodes;
+
+		//Streaming checks while parsing (see Schema::parse)
+		class ScanValidator : public ScanHandler
+		{
+		public:
+			explicit ScanValidator(const Impl& schema) : m_schema(schema) {}
+			bool onValue(char first) override
+			{
+				size_t idx{ m_next };
+				m_next = ANY;
+				if (!m_levels.empty() && !m_levels.back().isObject)
+				{
+					Level& level = m_levels.back();
+					++level.count;
+					if (ANY != level.node)
+					{
+						const Node& node = m_schema.nodes[level.node];
+						if (node.maxItems < level.count)
+							return fail("maxItems", true);
+						idx = node.items;
+					}
+				}
+				const uint8_t type = '{' == first ? T_OBJECT : '[' == first ? T_ARRAY : '"' == first ? T_STRING
+					: 't' == first || 'f' == first ? T_BOOL : 'n' == first ? T_NULL : T_INTEGER | T_NUMBER;
+				if (ANY != idx && 0 == (m_schema.nodes[idx].types & type))
+					return fail("type");
+				if (T_OBJECT == type || T_ARRAY == type)
+				{
+					m_levels.emplace_back();
+					m_levels.back().isObject = T_OBJECT == type;
+					m_levels.back().node = idx;
+				}
+				return true;
+			}
+			bool onKey(const char* key, size_t sz) override
+			{
+				Level& level = m_levels.back();
+				level.key.assign(key, sz);
+				++level.count;
+				m_next = ANY;
+				if (memchr(key, '\\', sz) && !unescape(level.key))
+					return fail("Invalid key");
+				if (ANY == level.node)
+					return true;
+				const Node& node = m_schema.nodes[level.node];
+				if (const Property* prop = m_schema.findProp(node, level.key.c_str(), level.key.size()))
+				{
+					m_next = prop->node;
+					if (prop->required)
+						++level.requiredCnt;
+				}
+				else if (!node.additional)
+					return fail("additionalProperties");
+				else
+					m_next = node.additionalNode;
+				return true;
+			}
+			bool onEnd() override
+			{//counts can only be too high (duplicate keys), so minimums are safe to check
+				const Level& level = m_levels.back();
+				if (ANY != level.node)
+				{
+					const Node& node = m_schema.nodes[level.node];
+					if (level.isObject ? node.minProps > level.count : node.minItems > level.count)
+						return fail(level.isObject ? "minProperties" : "minItems", true);
+					if (level.isObject && node.requiredCnt > level.requiredCnt)
+						return fail("required", true);
+				}
+				m_levels.pop_back();
+				return true;
+			}
+			const std::string& why() const { return m_why; }
+
+		private:
+			static bool unescape(std::string& key)
+			{//the (raw) key of the scanner, as a JSON string
+				key.insert(key.begin(), '"');
+				key += '"';
+				json_t* str = json_loadb(key.c_str(), key.size(), JSON_DECODE_ANY | JSON_ALLOW_NUL, nullptr);
+				if (!json_is_string(str))
+					return json_decref(str), false;
+				key.assign(json_string_value(str), json_string_length(str));
+				json_decref(str);
+				return true;
+			}
+			struct Level
+			{
+				bool isObject{ false };
+				size_t node{ ANY };
+				size_t count{ 0 };
+				size_t requiredCnt{ 0 };
+				std::string key;//the last one
+			};
+			const Impl& m_schema;
+			std::vector<Level> m_levels;
+			size_t m_next{ 0 };//node of the next value (the root first)
+			std::string m_why;
+
+			bool fail(const char* reason, bool container = false)
+			{//JSON pointer of the value started last (or of the container ending)
+				const size_t levels{ m_levels.size() - (container ? 1 : 0) };
+				for (size_t i = 0; i != levels; ++i)
+					m_why += '/' + (m_levels[i].isObject ? pointerEscape(m_levels[i].key) : std::to_string(m_levels[i].count - 1));
+				m_why.append(": ").append(reason);
+				return false;
+			}
+		};
+
+		static std::string pointerEscape(const std::string& key)
+		{
+			std::string ret;
+			for (const char c : key)
+				if ('~' == c)
+					ret += "~0";
+				else if ('/' == c)
+					ret += "~1";
+				else
+					ret += c;
+			return ret;
+		}
+
+		static size_t count(const json_t* v, const char* keyword)
+		{
+			if (!json_is_integer(v) || 0 > json_integer_value(v))
+				throw Exc(std::string("JSON error: Schema ") + keyword + " must be a non negative integer");
+			return size_t(json_integer_value(v));
+		}
+
+		static double number(const json_t* v, const char* keyword)
+		{
+			if (!json_is_number(v))
+				throw Exc(std::string("JSON error: Schema ") + keyword + " must be a number");
+			return json_number_value(v);
+		}
+
+		static uint8_t typeMask(const json_t* v)
+		{
+			const char* type = json_string_value(v);
+			if (!type)
+				throw Exc("JSON error: Schema type must be a string or an array of strings");
+			static const std::pair<const char*, uint8_t> TYPES[]{ {"null", T_NULL}, {"boolean", T_BOOL}, {"integer", T_INTEGER}
+				, {"number", T_INTEGER | T_NUMBER}, {"string", T_STRING}, {"array", T_ARRAY}, {"object", T_OBJECT} };
+			for (const auto& t : TYPES)
+				if (0 == strcmp(t.first, type))
+					return t.second;
+			throw Exc(std::string("JSON error: Unknown schema type: ") + type);
+		}
+
+		size_t compile(const json_t* schema)
+		{
+			if (json_is_true(schema))
+				return ANY;
+			const size_t idx{ nodes.size() };
+			nodes.emplace_back();
+			if (json_is_false(schema))
+				return nodes[idx].types = 0, idx;
+			if (!json_is_object(schema))
+				throw Exc("JSON error: Schema must be an object or a boolean");
+			json_t* obj = const_cast<json_t*>(schema);
+			std::vector<const char*> required;
+			for (void* it = json_object_iter(obj); it; it = json_object_iter_next(obj, it))
+			{
+				const std::string key{ json_object_iter_key(it) };
+				json_t* v = json_object_iter_value(it);
+				if ("type" == key)
+				{
+					uint8_t types{ 0 };
+					if (json_is_array(v))
+						for (size_t i = 0; i != json_array_size(v); ++i)
+							types |= typeMask(json_array_get(v, i));
+					else
+						types = typeMask(v);
+					nodes[idx].types = types;
+				}
+				else if ("enum" == key || "const" == key)
+				{
+					if ("enum" == key && !json_is_array(v))
+						throw Exc("JSON error: Schema enum must be an array");
+					nodes[idx].hasEnum = true;
+					if ("const" == key)
+						nodes[idx].enumVals.emplace_back(v);
+					else
+						for (size_t i = 0; i != json_array_size(v); ++i)
+							nodes[idx].enumVals.emplace_back(json_array_get(v, i));
+				}
+				else if ("properties" == key)
+				{
+					if (!json_is_object(v))
+						throw Exc("JSON error: Schema properties must be an object");
+					for (void* propIt = json_object_iter(v); propIt; propIt = json_object_iter_next(v, propIt))
+					{
+						const char* propKey = json_object_iter_key(propIt);
+						const size_t child{ compile(json_object_iter_value(propIt)) };
+						nodes[idx].props.push_back({ propKey, hashBytes(propKey, strlen(propKey)), child, false });
+					}
+				}
+				else if ("required" == key)
+				{
+					if (!json_is_array(v))
+						throw Exc("JSON error: Schema required must be an array of strings");
+					for (size_t i = 0; i != json_array_size(v); ++i)
+						if (const char* req = json_string_value(json_array_get(v, i)))
+							required.push_back(req);
+						else
+							throw Exc("JSON error: Schema required must be an array of strings");
+				}
+				else if ("additionalProperties" == key)
+				{
+					if (json_is_boolean(v))
+						nodes[idx].additional = json_is_true(v);
+					else
+					{
+						const size_t child{ compile(v) };
+						nodes[idx].additionalNode = child;
+					}
+				}
+				else if ("items" == key)
+				{
+					if (json_is_array(v))
+						throw Exc("JSON error: Schema items arrays (tuples) are not supported");
+					const size_t child{ compile(v) };
+					nodes[idx].items = child;
+				}
+				else if ("minItems" == key)
+					nodes[idx].minItems = count(v, "minItems");
+				else if ("maxItems" == key)
+					nodes[idx].maxItems = count(v, "maxItems");
+				else if ("minProperties" == key)
+					nodes[idx].minProps = count(v, "minProperties");
+				else if ("maxProperties" == key)
+					nodes[idx].maxProps = count(v, "maxProperties");
+				else if ("minLength" == key)
+					nodes[idx].minLength = count(v, "minLength");
+				else if ("maxLength" == key)
+					nodes[idx].maxLength = count(v, "maxLength");
+				else if ("minimum" == key)
+				{
+					nodes[idx].hasMin = true;
+					nodes[idx].min = number(v, "minimum");
+				}
+				else if ("maximum" == key)
+				{
+					nodes[idx].hasMax = true;
+					nodes[idx].max = number(v, "maximum");
+				}
+				else if ("exclusiveMinimum" == key || "exclusiveMaximum" == key)
+				{
+					const bool isMin{ "exclusiveMinimum" == key };
+					if (json_is_boolean(v))//draft 4
+						(isMin ? nodes[idx].exclMin : nodes[idx].exclMax) = json_is_true(v);
+					else
+					{
+						(isMin ? nodes[idx].hasMin : nodes[idx].hasMax) = true;
+						(isMin ? nodes[idx].exclMin : nodes[idx].exclMax) = true;
+						(isMin ? nodes[idx].min : nodes[idx].max) = number(v, key.c_str());
+					}
+				}
+				else if ("pattern" == key)
+				{
+					if (!json_is_string(v))
+						throw Exc("JSON error: Schema pattern must be a string");
+					try
+					{
+						nodes[idx].pattern = std::make_shared<const std::regex>(json_string_value(v), std::regex::ECMAScript);
+					}
+					catch (const std::regex_error& e)
+					{
+						throw Exc(std::string("JSON error: Invalid schema pattern: ") + e.what());
+					}
+				}
+				else if ("$schema" != key && "$id" != key && "id" != key && "$comment" != key && "title" != key
+					&& "description" != key && "default" != key && "examples" != key && "format" != key)
+					throw Exc("JSON error: Unsupported schema keyword: " + key);
+			}
+			Node& node = nodes[idx];
+			for (const char* req : required)
+			{
+				auto it = std::find_if(node.props.begin(), node.props.end(), [req](const Property& prop) { return prop.key == req; });
+				if (node.props.end() == it)
+					it = node.props.insert(node.props.end(), { req, hashBytes(req, strlen(req)), ANY, false });
+				if (!it->required)
+					++node.requiredCnt;
+				it->required = true;
+			}
+			if (!node.props.empty())
+			{
+				size_t tableSz{ 4 };
+				while (tableSz < 2 * node.props.size())
+					tableSz *= 2;
+				node.propTable.assign(tableSz, 0);
+				for (size_t i = 0; i != node.props.size(); ++i)
+				{
+					size_t pos{ size_t(node.props[i].hash) & (tableSz - 1) };
+					while (0 != node.propTable[pos])
+						pos = (pos + 1) & (tableSz - 1);
+					node.propTable[pos] = uint32_t(i + 1);
+				}
+			}
+			return idx;
+		}
+
+		//What ScanValidator can not check: enum/const, integer (vs number) type, numeric bounds, string length and pattern,
+		//and the ones which duplicate keys skew (maxProperties, required)
+		bool markRescan(size_t idx)
+		{
+			Node& node = nodes[idx];
+			for (const Property& prop : node.props)
+				node.childRescan = (ANY != prop.node && markRescan(prop.node)) || node.childRescan;
+			node.childRescan = (ANY != node.additionalNode && markRescan(node.additionalNode)) || node.childRescan;
+			node.childRescan = (ANY != node.items && markRescan(node.items)) || node.childRescan;
+			node.rescan = node.childRescan || node.hasEnum || node.hasMin || node.hasMax || 0 != node.minLength
+				|| size_t(-1) != node.maxLength || node.pattern || size_t(-1) != node.maxProps || 0 != node.requiredCnt
+				|| (0 != (node.types & T_INTEGER) && 0 == (node.types & T_NUMBER));
+			return node.rescan;
+		}
+
+		const Property* findProp(const Node& node, const char* key, size_t sz) const
+		{
+			if (node.propTable.empty())
+				return nullptr;
+			const uint64_t hash{ hashBytes(key, sz) };
+			const size_t mask{ node.propTable.size() - 1 };
+			for (size_t pos = size_t(hash) & mask; 0 != node.propTable[pos]; pos = (pos + 1) & mask)
+			{
+				const Property& prop = node.props[node.propTable[pos] - 1];
+				if (hash == prop.hash && sz == prop.key.size() && 0 == memcmp(key, prop.key.data(), sz))
+					return &prop;
+			}
+			return nullptr;
+		}
+
+		static bool fail(std::string* why, const char* reason)
+		{
+			if (why)
+				why->append(": ").append(reason);
+			return false;
+		}
+
+		static bool failAt(std::string* why, const std::string& step)
+		{//prepend the path step while unwinding
+			if (why)
+				why->insert(0, '/' + step);
+			return false;
+		}
+
+		//full: false after ScanValidator, to walk only the subtrees with other checks (markRescan())
+		bool validate(size_t idx, const json_t* v, std::string* why, bool full) const
+		{
+			if (ANY == idx || (!full && !nodes[idx].rescan))
+				return true;
+			const Node& node = nodes[idx];
+			uint8_t type;
+			switch (json_typeof(v))
+			{
+			case JSON_OBJECT: type = T_OBJECT; break;
+			case JSON_ARRAY: type = T_ARRAY; break;
+			case JSON_STRING: type = T_STRING; break;
+			case JSON_INTEGER: type = T_INTEGER; break;
+			case JSON_REAL:
+			{
+				const double d{ json_real_value(v) };
+				type = std::floor(d) == d ? T_INTEGER | T_NUMBER : T_NUMBER;//integer: no fractional part
+				break;
+			}
+			case JSON_TRUE: case JSON_FALSE: type = T_BOOL; break;
+			default: type = T_NULL;
+			}
+			if (0 == (node.types & type))
+				return fail(why, "type");
+			if (node.hasEnum && node.enumVals.end() == std::find_if(node.enumVals.begin(), node.enumVals.end()
+				, [v](const Value& val) { return json_equal(ValueRaw::get(val), const_cast<json_t*>(v)); }))
+				return fail(why, node.enumVals.size() == 1 ? "const" : "enum");
+			switch (json_typeof(v))
+			{
+			case JSON_OBJECT:
+			{
+				const size_t sz{ json_object_size(v) };
+				if (node.minProps > sz)
+					return fail(why, "minProperties");
+				if (node.maxProps < sz)
+					return fail(why, "maxProperties");
+				size_t requiredCnt{ 0 };
+				json_t* obj = const_cast<json_t*>(v);
+				if (!full && !node.childRescan)
+					obj = nullptr;//the keys were checked while streaming. required by lookup below
+				for (void* it = obj ? json_object_iter(obj) : nullptr; it; it = json_object_iter_next(obj, it))
+				{
+					const char* key = json_object_iter_key(it);
+					size_t child{ ANY };
+					if (const Property* prop = findProp(node, key, strlen(key)))
+					{
+						child = prop->node;
+						requiredCnt += prop->required ? 1 : 0;
+					}
+					else if (!node.additional)
+						return fail(why, "additionalProperties"), failAt(why, pointerEscape(key));
+					else
+						child = node.additionalNode;
+					if (!validate(child, json_object_iter_value(it), why, full))
+						return failAt(why, pointerEscape(key));
+				}
+				if (node.requiredCnt != requiredCnt)
+					for (const Property& prop : node.props)
+						if (prop.required && !json_object_get(v, prop.key.c_str()))
+							return fail(why, "required"), failAt(why, pointerEscape(prop.key));
+				break;
+			}
+			case JSON_ARRAY:
+			{
+				const size_t sz{ json_array_size(v) };
+				if (node.minItems > sz)
+					return fail(why, "minItems");
+				if (node.maxItems < sz)
+					return fail(why, "maxItems");
+				if (ANY != node.items && (full || nodes[node.items].rescan))
+					for (size_t i = 0; i != sz; ++i)
+						if (!validate(node.items, json_array_get(v, i), why, full))
+							return failAt(why, std::to_string(i));
+				break;
+			}
+			case JSON_STRING:
+			{
+				const char* str = json_string_value(v);
+				const size_t sz{ json_string_length(v) };
+				if (0 != node.minLength || size_t(-1) != node.maxLength)
+				{
+					size_t len{ 0 };//code points
+					for (size_t i = 0; i != sz; ++i)
+						len += 0x80 != (uint8_t(str[i]) & 0xC0) ? 1 : 0;
+					if (node.minLength > len)
+						return fail(why, "minLength");
+					if (node.maxLength < len)
+						return fail(why, "maxLength");
+				}
+				if (node.pattern && !std::regex_search(str, str + sz, *node.pattern))
+					return fail(why, "pattern");
+				break;
+			}
+			case JSON_INTEGER:
+			case JSON_REAL:
+			{
+				const double d{ json_number_value(v) };
+				if (node.hasMin && (node.exclMin ? d <= node.min : d < node.min))
+					return fail(why, node.exclMin ? "exclusiveMinimum" : "minimum");
+				if (node.hasMax && (node.exclMax ? d >= node.max : d > node.max))
+					return fail(why, node.exclMax ? "exclusiveMaximum" : "maximum");
+				break;
+			}
+			default: break;
+			}
+			return true;
+		}
+	};
+
+	Schema::Schema(const Value& schema)
+	{
+		if (schema.isEmpty())
+			throw Exc("JSON error: Empty schema");
+		std::shared_ptr<Impl> impl{ std::make_shared<Impl>() };
+		impl->compile(ValueRaw::get(schema));
+		if (!impl->nodes.empty())
+			impl->markRescan(0);
+		m_impl = impl;
+	}
+
+	bool Schema::validate(const Value& val, std::string* why) const
+	{
+		if (why)
+			why->clear();
+		if (val.isEmpty())
+			return Impl::fail(why, "missing value");
+		return m_impl->nodes.empty() || m_impl->validate(0, ValueRaw::get(val), why, true);
+	}
+
+	Expected<Value> Schema::parse(const char* cStr, size_t sz, std::string* why, const ParseLimits& limits) const
+	{
+		if (why)
+			why->clear();
+		Impl::ScanValidator validator{ *m_impl };
+		Expected<Value> ret{ scannedParse(cStr, sz, limits, m_impl->nodes.empty() ? nullptr : &validator) };
+		if (!ret)
+		{
+			if (why && Errc::Invalid == ret.error().code)
+				*why = validator.why();
+			return ret;
+		}
+		if (!m_impl->nodes.empty() && !m_impl->validate(0, ValueRaw::get(*ret), why, false))
+		{
+			Error err;
+			err.code = Errc::Invalid;
+			return err;
+		}
+		return ret;
 	}
 
 //Optimized (no extra mem copy) with boost, if can
@@ -646,4 +5359,412 @@ namespace json //using namespace will not work for the free functions
 		return ret;
 	}
 #endif
+
+	namespace
+	{
+		const size_t FILE_IO_SIZE{ 4 * 1024 * 1024 };
+
+		//Written next to the target and renamed over it by commit(), removed if not committed
+		class AtomicFileWriter
+		{
+		public:
+			explicit AtomicFileWriter(const char* path)
+				: m_path(path)
+			{
+				static std::atomic<unsigned> s_cnt{ 0 };
+#if defined(_WIN32)
+				m_tmpPath = m_path + ".tmp" + std::to_string(GetCurrentProcessId()) + '_' + std::to_string(++s_cnt);
+				m_file = CreateFileA(m_tmpPath.c_str(), GENERIC_WRITE, 0, NULL, CREATE_NEW, FILE_ATTRIBUTE_NORMAL, NULL);
+				if (INVALID_HANDLE_VALUE == m_file)
+#else
+				m_tmpPath = m_path + ".tmp" + std::to_string(getpid()) + '_' + std::to_string(++s_cnt);
+				m_fd = ::open(m_tmpPath.c_str(), O_WRONLY | O_CREAT | O_EXCL | O_CLOEXEC, 0666);
+				struct stat st;
+				if (0 <= m_fd && 0 == stat(path, &st))
+					fchmod(m_fd, st.st_mode & 07777);//keep the permissions of the replaced file
+				if (0 > m_fd)
+#endif
+					throw Exc("JSON error: Can not create file " + m_tmpPath);
+			}
+			~AtomicFileWriter()
+			{
+				if (!m_committed)
+				{
+					close();
+#if defined(_WIN32)
+					DeleteFileA(m_tmpPath.c_str());
+#else
+					unlink(m_tmpPath.c_str());
+#endif
+				}
+			}
+			AtomicFileWriter(const AtomicFileWriter&) = delete;
+			AtomicFileWriter& operator=(const AtomicFileWriter&) = delete;
+
+			bool write(const char* data, size_t sz)
+			{
+				while (0 != sz)
+				{
+#if defined(_WIN32)
+					DWORD written;
+					if (!WriteFile(m_file, data, DWORD(std::min<size_t>(sz, 1u << 30)), &written, NULL))
+						return false;
+#else
+					const ssize_t written{ ::write(m_fd, data, sz) };
+					if (0 > written)
+					{
+						if (EINTR == errno)
+							continue;
+						return false;
+					}
+#endif
+					data += written;
+					sz -= size_t(written);
+				}
+				return true;
+			}
+			//Flush to the disk and replace the target
+			void commit()
+			{
+#if defined(_WIN32)
+				const bool ok{ FlushFileBuffers(m_file) && close()
+					&& MoveFileExA(m_tmpPath.c_str(), m_path.c_str(), MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH) };
+#else
+				const bool ok{ 0 == fsync(m_fd) && close() && 0 == rename(m_tmpPath.c_str(), m_path.c_str()) };
+#endif
+				if (!ok)
+					throw Exc("JSON error: Can not write file " + m_path);
+				m_committed = true;
+#if !defined(_WIN32)
+				//make the rename itself durable
+				const size_t slash{ m_path.rfind('/') };
+				const int dirFd = ::open(std::string::npos == slash ? "." : 0 == slash ? "/" : m_path.substr(0, slash).c_str(), O_RDONLY | O_CLOEXEC);
+				if (0 <= dirFd)
+				{
+					fsync(dirFd);
+					::close(dirFd);
+				}
+#endif
+			}
+
+		private:
+			const std::string m_path;
+			std::string m_tmpPath;
+			bool m_committed{ false };
+#if defined(_WIN32)
+			HANDLE m_file{ INVALID_HANDLE_VALUE };
+			bool close()
+			{
+				const bool ret{ INVALID_HANDLE_VALUE == m_file || CloseHandle(m_file) };
+				m_file = INVALID_HANDLE_VALUE;
+				return ret;
+			}
+#else
+			int m_fd{ -1 };
+			bool close()
+			{
+				const bool ret{ 0 > m_fd || 0 == ::close(m_fd) };
+				m_fd = -1;
+				return ret;
+			}
+#endif
+		};
+
+		bool fileFlush(std::string& buf, void* data)
+		{
+			const bool ret{ ((AtomicFileWriter*)data)->write(buf.data(), buf.size()) };
+			buf.clear();
+			return ret;
+		}
+	}
+
+	Value loadFile(const char* path)
+	{
+		ZJSON_TRACE_SCOPE(TraceOp::Parse);
+		MappedFile file{ path };
+		json_error_t err;
+		json_t* v;
+		size_t inputSz{ file.size() };
+		if (file.mapped())
+			v = json_loadb(file.data(), file.size(), 0, &err);
+		else
+		{//empty or can not be mapped (e.g. pipe): read from the same open file
+			std::string buf;
+			if (!file.read(buf, FILE_IO_SIZE))
+				throw Exc(std::string("JSON error: Can not read file ") + path);
+			inputSz = buf.size();
+			v = json_loadb(buf.data(), buf.size(), 0, &err);
+		}
+		if (NULL == v)
+			throwLoadErr(err);
+		ZJSON_TRACE_DONE(inputSz);
+		return ValueRaw::steal(v);
+	}
+
+	void saveFile(const char* path, const Value& val, bool sortIt, int identSpaces)
+	{
+		if (val.isEmpty())
+			throw Exc("JSON error: Can not save an empty value");
+		ZJSON_TRACE_SCOPE(TraceOp::Dump);
+		AtomicFileWriter file{ path };
+		std::string buf;
+		buf.reserve(FILE_IO_SIZE + DUMP_FLUSH_SIZE);
+		Dumper dumper((0 == identSpaces ? JSON_COMPACT : JSON_INDENT(identSpaces)) | (sortIt ? JSON_SORT_KEYS : 0)
+			, buf, &fileFlush, &file, FILE_IO_SIZE);
+		if (!dumper.dump(ValueRaw::get(val)))
+			throw Exc(std::string("JSON serialization failed (invalid UTF8 string?) or can not write file ") + path);
+		if (!dumper.flush())
+			throw Exc(std::string("JSON error: Can not write file ") + path);
+		file.commit();
+		ZJSON_TRACE_DONE(dumper.outputSize());
+	}
+}
+
+#if defined(ZJSON_HAS_ZLIB) || defined(ZJSON_HAS_ZSTD)
+namespace json
+{
+	namespace
+	{
+		const size_t COMPRESS_CHUNK_SIZE{ 128 * 1024 };
+
+		//One direction of a compression library stream
+		class Codec
+		{
+		public:
+			virtual ~Codec() {}
+			//Consume from [in, inEnd) and produce to [out, outEnd), advancing in and out. Throws Exc on corrupted data.
+			//True at the end of the (de)compressed stream (when compressing: only if end and everything is output).
+			virtual bool run(const char*& in, const char* inEnd, char*& out, char* outEnd, bool end) = 0;
+			virtual void reset() = 0;//decompression of the next concatenated stream
+		};
+
+#if defined(ZJSON_HAS_ZLIB)
+		class ZlibCodec : public Codec
+		{
+		public:
+			ZlibCodec(bool compress, int level)
+				: m_compress(compress)
+			{//gzip header when compressing, gzip or zlib header detected when decompressing
+				const int err{ compress ? deflateInit2(&m_z, level, Z_DEFLATED, 15 + 16, 8, Z_DEFAULT_STRATEGY) : inflateInit2(&m_z, 15 + 32) };
+				if (Z_OK != err)
+					throw Exc("JSON error: zlib initialization failure");
+			}
+			~ZlibCodec()
+			{
+				if (m_compress)
+					deflateEnd(&m_z);
+				else
+					inflateEnd(&m_z);
+			}
+			bool run(const char*& in, const char* inEnd, char*& out, char* outEnd, bool end) override
+			{//chunks are smaller than uInt max
+				m_z.next_in = (Bytef*)in;
+				m_z.avail_in = uInt(inEnd - in);
+				m_z.next_out = (Bytef*)out;
+				m_z.avail_out = uInt(outEnd - out);
+				const int err{ m_compress ? deflate(&m_z, end ? Z_FINISH : Z_NO_FLUSH) : inflate(&m_z, Z_NO_FLUSH) };
+				in = (const char*)m_z.next_in;
+				out = (char*)m_z.next_out;
+				if (Z_STREAM_END == err)
+					return true;
+				if (Z_OK != err && Z_BUF_ERROR != err)
+					throw Exc(std::string("JSON error: zlib failure: ") + (m_z.msg ? m_z.msg : std::to_string(err).c_str()));
+				return false;
+			}
+			void reset() override { inflateReset(&m_z); }
+
+		private:
+			const bool m_compress;
+			z_stream m_z{};
+		};
+#endif
+
+#if defined(ZJSON_HAS_ZSTD)
+		class ZstdCodec : public Codec
+		{
+		public:
+			ZstdCodec(bool compress, int level)
+			{
+				if (compress)
+				{
+					m_cctx = ZSTD_createCCtx();
+					if (m_cctx && -1 != level)
+						ZSTD_CCtx_setParameter(m_cctx, ZSTD_c_compressionLevel, level);
+				}
+				else
+					m_dctx = ZSTD_createDCtx();
+				if (!m_cctx && !m_dctx)
+					throw Exc("JSON error: zstd initialization failure");
+			}
+			~ZstdCodec()
+			{
+				ZSTD_freeCCtx(m_cctx);
+				ZSTD_freeDCtx(m_dctx);
+			}
+			bool run(const char*& in, const char* inEnd, char*& out, char* outEnd, bool end) override
+			{
+				ZSTD_inBuffer inBuf{ in, size_t(inEnd - in), 0 };
+				ZSTD_outBuffer outBuf{ out, size_t(outEnd - out), 0 };
+				const size_t ret{ m_cctx ? ZSTD_compressStream2(m_cctx, &outBuf, &inBuf, end ? ZSTD_e_end : ZSTD_e_continue)
+					: ZSTD_decompressStream(m_dctx, &outBuf, &inBuf) };
+				in += inBuf.pos;
+				out += outBuf.pos;
+				if (ZSTD_isError(ret))
+					throw Exc(std::string("JSON error: zstd failure: ") + ZSTD_getErrorName(ret));
+				return 0 == ret && (end || m_dctx);//0: frame completely decompressed or flushed
+			}
+			void reset() override {}//the same context continues with the next frame
+
+		private:
+			ZSTD_CCtx* m_cctx{ nullptr };
+			ZSTD_DCtx* m_dctx{ nullptr };
+		};
+#endif
+
+		std::unique_ptr<Codec> createEncoder(Compression compression, int level)
+		{
+			switch (compression)
+			{
+#if defined(ZJSON_HAS_ZLIB)
+			case Compression::Gzip: return std::unique_ptr<Codec>(new ZlibCodec(true, level));
+#endif
+#if defined(ZJSON_HAS_ZSTD)
+			case Compression::Zstd: return std::unique_ptr<Codec>(new ZstdCodec(true, level));
+#endif
+			default: throw Exc("JSON error: Compression not available in this build");
+			}
+		}
+
+		std::unique_ptr<Codec> createDecoder(const char* data, size_t sz)
+		{
+			const uint8_t* b = (const uint8_t*)data;
+#if defined(ZJSON_HAS_ZLIB)
+			if (2 <= sz && ((0x1F == b[0] && 0x8B == b[1]) || (8 == (b[0] & 0x0F) && 0 == (b[0] * 256u + b[1]) % 31)))//gzip or zlib
+				return std::unique_ptr<Codec>(new ZlibCodec(false, 0));
+#endif
+#if defined(ZJSON_HAS_ZSTD)
+			if (4 <= sz && 0x28 == b[0] && 0xB5 == b[1] && 0x2F == b[2] && 0xFD == b[3])
+				return std::unique_ptr<Codec>(new ZstdCodec(false, 0));
+#endif
+			(void)b;
+			throw Exc("JSON error: Unknown or unavailable compression format");
+		}
+	}
+
+	struct CompressedIStreamBuf::Impl
+	{
+		std::istream& src;
+		std::unique_ptr<Codec> codec;
+		std::vector<char> in;
+		std::vector<char> out;
+		const char* inPos{ nullptr };
+		const char* inEnd{ nullptr };
+		bool ended{ false };//the last compressed stream is complete
+	};
+
+	CompressedIStreamBuf::CompressedIStreamBuf(std::istream& src)
+		: m_impl(new Impl{ src, nullptr, std::vector<char>(COMPRESS_CHUNK_SIZE), std::vector<char>(COMPRESS_CHUNK_SIZE) })
+	{}
+
+	CompressedIStreamBuf::~CompressedIStreamBuf() {}
+
+	CompressedIStreamBuf::int_type CompressedIStreamBuf::underflow()
+	{//exceptions make the istream bad
+		Impl& d = *m_impl;
+		char* out = d.out.data();
+		char* const outEnd = out + d.out.size();
+		while (d.out.data() == out)
+		{
+			if (d.inPos == d.inEnd)
+			{
+				d.src.read(d.in.data(), std::streamsize(d.in.size()));
+				d.inPos = d.in.data();
+				d.inEnd = d.inPos + d.src.gcount();
+				if (d.inPos == d.inEnd)
+				{
+					if (!d.ended || d.src.bad())
+						throw Exc("JSON error: Truncated compressed data");
+					return traits_type::eof();
+				}
+			}
+			if (!d.codec)
+				d.codec = createDecoder(d.inPos, size_t(d.inEnd - d.inPos));
+			else if (d.ended)
+				d.codec->reset();
+			d.ended = d.codec->run(d.inPos, d.inEnd, out, outEnd, false);
+		}
+		setg(d.out.data(), d.out.data(), out);
+		return traits_type::to_int_type(*gptr());
+	}
+
+	struct CompressedOStreamBuf::Impl
+	{
+		std::ostream& dst;
+		std::unique_ptr<Codec> codec;
+		std::vector<char> in;
+		std::vector<char> out;
+		bool finished{ false };
+	};
+
+	CompressedOStreamBuf::CompressedOStreamBuf(std::ostream& dst, Compression compression, int level)
+		: m_impl(new Impl{ dst, createEncoder(compression, level), std::vector<char>(COMPRESS_CHUNK_SIZE), std::vector<char>(COMPRESS_CHUNK_SIZE) })
+	{
+		setp(m_impl->in.data(), m_impl->in.data() + m_impl->in.size());
+	}
+
+	CompressedOStreamBuf::~CompressedOStreamBuf()
+	{
+		finish();
+	}
+
+	bool CompressedOStreamBuf::compress(bool end)
+	{
+		Impl& d = *m_impl;
+		if (d.finished)
+			return pbase() == pptr();//nothing can be written after the end
+		d.finished = end;
+		const char* in = pbase();
+		bool ended;
+		do
+		{
+			char* out = d.out.data();
+			ended = d.codec->run(in, pptr(), out, d.out.data() + d.out.size(), end);
+			if (!d.dst.write(d.out.data(), std::streamsize(out - d.out.data())))
+				return false;
+		} while (in != pptr() || (end && !ended));
+		setp(d.in.data(), d.in.data() + d.in.size());
+		return true;
+	}
+
+	bool CompressedOStreamBuf::finish()
+	{
+		if (m_impl->finished)
+			return true;
+		try
+		{
+			return compress(true) && m_impl->dst.flush();
+		}
+		catch (const Exc&)
+		{
+			return false;
+		}
+	}
+
+	CompressedOStreamBuf::int_type CompressedOStreamBuf::overflow(int_type c)
+	{
+		if (!compress(false))
+			return traits_type::eof();
+		if (!traits_type::eq_int_type(c, traits_type::eof()))
+		{
+			*pptr() = traits_type::to_char_type(c);
+			pbump(1);
+		}
+		return traits_type::not_eof(c);
+	}
+
+	int CompressedOStreamBuf::sync()
+	{
+		return compress(false) && m_impl->dst.flush() ? 0 : -1;
+	}
 }
+#endif
@@ -1,9 +1,14 @@
 #pragma once
+#include <array>
+#include <functional>
+#include <iterator>
+#include <memory>
 #include <stdexcept>
 #include <string>
 #include <sstream>
 #include <type_traits>
 #include <utility>
+#include <vector>
 
 struct json_t;
 
@@ -36,6 +41,16 @@ namespace detail {
 	struct has_arrow<T, decltype(void(std::declval<T&>().operator->()))> : std::true_type {};
 }
 #endif
+#if defined(ZJSON_CPP20) && defined(__cpp_impl_coroutine)
+#define ZJSON_COROUTINES
+#include <coroutine>
+#endif
+#if (defined(ZJSON_CPP20) || (defined(__cplusplus) && __cplusplus >= 201703L) || (defined(_MSVC_LANG) && _MSVC_LANG >= 201703L)) && defined(__has_include)
+#if __has_include(<memory_resource>)
+#define ZJSON_PMR
+#include <memory_resource>
+#endif
+#endif
 
 namespace json
 {
@@ -46,6 +61,108 @@ namespace json
 		Exc(const std::string& msg) : std::runtime_error(msg) {}
 	};
 
+	//Error codes of the non throwing (try*) API
+	enum class Errc : uint8_t
+	{
+		Ok,
+		Syntax,//invalid JSON (or other parse failures)
+		PrematureEnd,
+		InvalidUtf8,
+		NumberOutOfRange,
+		TooDeep,//nesting depth limit
+		OutOfMemory,
+		Missing,//empty value, e.g. missing object field
+		WrongType,
+		//ParseLimits exceeded (TooDeep for the depth)
+		TooLarge,
+		StringTooLong,
+		TooManyElements,
+		TooManyKeys,
+		Invalid//Schema violation
+	};
+	struct Error
+	{
+		Errc code{ Errc::Ok };
+		int line{ 0 };//parse errors only (1 based)
+		int column{ 0 };
+		size_t position{ 0 };//bytes from the start of the input
+		const char* what() const;//static description of the code
+	};
+
+	//std::expected like result: the value or the Error. Always the same class (not std::expected even if available),
+	//so that the library and its users agree on the type regardless of their C++ standard. Failures do not allocate.
+	template<class T>
+	class Expected
+	{
+	public:
+		Expected(T val) : m_val(std::move(val)) {}
+		Expected(Error err) : m_err(err) {}
+		bool has_value() const { return Errc::Ok == m_err.code; }
+		explicit operator bool() const { return has_value(); }
+		const T& value() const { check(); return m_val; }
+		T& value() { check(); return m_val; }
+		T value_or(T def) const { return has_value() ? m_val : std::move(def); }
+		const T& operator*() const { return m_val; }
+		T& operator*() { return m_val; }
+		const T* operator->() const { return &m_val; }
+		T* operator->() { return &m_val; }
+		const Error& error() const { return m_err; }
+
+	private:
+		T m_val{};
+		Error m_err;
+		void check() const
+		{
+			if (!has_value())
+				throw Exc(std::string("JSON error: ") + m_err.what());
+		}
+	};
+
+	class Value;
+	class Array;
+	class Object;
+	//Path to a nested value as a list of object keys and array indexes, e.g. Path{ "users", 3, "name" }
+	//Compile once (e.g. from a JSON pointer) and evaluate against any number of values.
+	class ZJSON_EXP_IMP Path
+	{
+	public:
+		static const size_t NO_IDX{ size_t(-1) };
+		static const size_t END_IDX{ size_t(-2) };//"-" in JSON pointer: after the last array element (i.e. setIn() appends)
+		struct Step
+		{
+			Step(const char* key_) : key(key_), isKey(true) {}
+			Step(std::string key_) : key(std::move(key_)), isKey(true) {}
+			Step(size_t idx_) : idx(idx_) {}
+			Step(int idx_) : idx(size_t(idx_))
+			{
+				if (0 > idx_)
+					throw Exc("JSON error: Negative path index " + std::to_string(idx_));
+			}
+			std::string key;//for objects
+			size_t idx{ NO_IDX };//for arrays
+			bool isKey{ false };
+		};
+
+		Path() {}
+		Path(std::initializer_list<Step> steps) : m_steps(steps) {}
+		//RFC 6901 JSON pointer, e.g. "/users/3/name" ("~1" for '/' and "~0" for '~' in keys). Numeric steps fit both objects and arrays.
+		static Path fromPointer(const char* pointer);
+		static Path fromPointer(const std::string& pointer) { return fromPointer(pointer.c_str()); }
+		//dot separated steps (no escaping), e.g. "users.3.name"
+		static Path fromDotted(const char* dotted);
+		static Path fromDotted(const std::string& dotted) { return fromDotted(dotted.c_str()); }
+
+		//same as root.getIn(path): single walk, no intermediate temporaries
+		const Value eval(const Value& root) const;
+		bool empty() const { return m_steps.empty(); }
+		size_t size() const { return m_steps.size(); }
+		const Step& operator[](size_t i) const { return m_steps[i]; }
+		void push_back(Step step) { m_steps.push_back(std::move(step)); }
+
+	private:
+		std::vector<Step> m_steps;
+	};
+
 	class Array;
 	class Object;
 	// Reference counted json value. Not thread safe! Use deepCopy() to pass between threads.
@@ -93,10 +210,14 @@ namespace json
 		bool isString() const;
 		bool isArray() const;
 		bool isObject() const;
-		//deep compare
+		//deep compare (early-out on the same node and, with setHashCaching(true), on different hashes cached by hash())
 		bool operator==(const Value& rhs) const;
 		bool operator!=(const Value& rhs) const { return !(*this == rhs); }
 		bool isSameVal(const Value& rhs) const { return m_val == rhs.m_val; }
+		//structural hash, consistent with operator== (i.e. objects fields order is ignored). 0 for isEmpty()
+		size_t hash() const;
+		//estimated heap bytes of the whole document (jansson 2.14 layout, without malloc overhead). Shared nodes counted once
+		size_t memoryUsage() const;
 
 		bool asBool() const;
 		bool asBoolSafe() const;
@@ -130,6 +251,9 @@ namespace json
 		const char* c_strSafe(const char* def = "") const;
 		std::string asString() const { return c_str(); }
 		std::string asStringSafe(std::string def = {}) const;
+#if defined(ZJSON_PMR)
+		std::pmr::string asPmrString(std::pmr::memory_resource* resource) const { return { c_str(), resource }; }
+#endif
 #if defined(ZJSON_CPP20) //support for char8_t is through plain char* which is assumed to be UTF8 anyway
 		inline const char8_t* c_u8str() const { return (const char8_t*)c_str(); }
 		inline const char8_t* c_u8strSafe(const char8_t* defV = u8"") const { return (const char8_t*)c_strSafe((const char*)defV); }
@@ -141,17 +265,35 @@ namespace json
 		const Object asObject() const;
 		Array asArraySafe() const;
 		Object asObjectSafe() const;
+		//nested value, isEmpty() if any of the path steps is missing
+		const Value getIn(const Path& path) const;
+		//Non throwing accessors: Errc::Missing if isEmpty(), Errc::WrongType for other types
+		Expected<bool> tryAsBool() const;
+		Expected<int64_t> tryAsInt() const;
+		Expected<double> tryAsFloat() const;
+		Expected<double> tryAsFloatNum() const;//can be int or float
+		Expected<const char*> tryC_str() const;
+		Expected<std::string> tryAsString() const;
+		Expected<Array> tryAsArray() const;
+		Expected<Object> tryAsObject() const;
 
 		void dump(std::ostream&) const;//not just for logging!
-		std::string dump(size_t maxChars = 0) const;
+		std::string dump(size_t maxChars = 0) const;//cut (UTF8 safe) with "..." at maxChars, the rest is not serialized
+		//Opt-in (per thread) caching of the serialized text of this array/object (per output format). Any later output of it,
+		//or of any array/object containing it, copies the cached text. Array/Object modifiers drop the cached text (a shared
+		//value is copied first: the copy inherits the opt-in, but not the text). Use for big, rarely modified values.
+		void cacheDump(bool enable = true) const;
 
 	protected:
 		friend class Array; //for setAt()
 		friend class Object; //for setAt()
+		friend class PathSet;
+		friend struct ValueRaw;//internal (zjson.cpp) access to the json_t
 		json_t* m_val;
 
 		std::string type2String() const;
 		void cow();//read as CopyOnWrite
+		void updateNested(const Path& path, size_t stepIdx, const std::function<Value(const Value&)>& fn);
 
 	private:
 		void onCastErr(const std::string& toType) const
@@ -160,6 +302,78 @@ namespace json
 		}
 	};
 	ZJSON_EXP_IMP Value NULL_VALUE();
+	//Per thread. Cache the hashes of (non trivial) arrays and objects, so that hash() and operator== are O(1) for unchanged values.
+	//The caches (this one and cacheDump()) do not keep the values alive: an entry is dropped when its value is modified
+	//(cow()) or freed (the jansson allocator hooks installed at startup), by any thread.
+	ZJSON_EXP_IMP void setHashCaching(bool enable);
+
+	//Opt-in allocation telemetry (jansson allocator hooks). Call once at startup: it throws Exc once any Value has been
+	//created, since the blocks allocated before have no size header. It can not be disabled. The counters are 0 while not enabled.
+	ZJSON_EXP_IMP void enableMemoryStats();
+	struct MemoryCounters
+	{
+		uint64_t allocs{ 0 };
+		uint64_t frees{ 0 };
+		uint64_t allocBytes{ 0 };
+		uint64_t freeBytes{ 0 };
+		int64_t peakBytes{ 0 };//of liveBytes()
+		int64_t liveBytes() const { return int64_t(allocBytes - freeBytes); }
+	};
+	ZJSON_EXP_IMP MemoryCounters processMemoryCounters();
+	//Allocations and frees done by this thread (e.g. compare before and after a request handler). The blocks freed by
+	//another thread count there, hence liveBytes() can be negative.
+	ZJSON_EXP_IMP MemoryCounters threadMemoryCounters();
+	//{"enabled", "process": {"allocs", "frees", "liveBytes", "peakBytes", "sizeHistogram": {"16": n, "32": n, ..., "more": n}},
+	// "thread": {"allocs", "frees", "allocBytes", "freeBytes", "liveBytes", "peakBytes"}}. Histogram buckets are by
+	//allocation size (upper bound).
+	ZJSON_EXP_IMP Object memoryStats();
+
+#if defined(ZJSON_PMR)
+	//Opt-in std::pmr allocation of the values' nodes and strings (jansson allocator hooks, shared with enableMemoryStats()).
+	//Call once at startup, before any Value is created (throws Exc otherwise). Without an active MemoryResourceScope the
+	//allocations use malloc.
+	ZJSON_EXP_IMP void enableMemoryResources();
+	//Per thread. The values created (parsed, copied on write, ...) in the scope are allocated from the resource, which
+	//has to outlive them: each block records its resource, so it is deallocated there from any thread and any scope.
+	//E.g. parse a request into a std::pmr::monotonic_buffer_resource and release it all at once after the response.
+	class ZJSON_EXP_IMP MemoryResourceScope
+	{
+	public:
+		explicit MemoryResourceScope(std::pmr::memory_resource* resource);
+		~MemoryResourceScope();//restores the previous resource of the thread
+		MemoryResourceScope(const MemoryResourceScope&) = delete;
+		MemoryResourceScope& operator=(const MemoryResourceScope&) = delete;
+	private:
+		std::pmr::memory_resource* m_prev;
+	};
+#endif
+
+#if defined(ZJSON_TRACING)
+	//Operation tracing, compiled in with ZJSON_TRACING (CMake option). Without a sink it costs an atomic pointer load.
+	enum class TraceOp
+	{
+		Parse,//stream operator>> (hence strToObject/strToArray) and loadFile. size: input bytes
+		Dump,//stream operator<< (hence jsonToString) and saveFile. size: output bytes
+		Cow,//shallow copy of a shared value before its modification. size: elements (or string bytes) copied
+		DeepCopy//size: top level elements
+	};
+	struct TraceEvent
+	{
+		TraceOp op;
+		uint64_t nanos;
+		size_t size;
+		bool ok;//false if failed (threw)
+	};
+	class ZJSON_EXP_IMP TraceSink
+	{
+	public:
+		virtual ~TraceSink() {}
+		//Called by the thread doing the operation, so it must be thread safe (and fast)
+		virtual void onEvent(const TraceEvent& ev) = 0;
+	};
+	//Process wide. nullptr to stop. The sink must outlive any operation started while it was set.
+	ZJSON_EXP_IMP void setTraceSink(TraceSink* sink);
+#endif
 	template<typename IntT>
 	inline IntT Value::asIntT() const
 	{
@@ -238,7 +452,8 @@ namespace json
 		}
 		//create vector "like" container with elements constructible from primitive type. E.g.:
 		// using StrVec=std::vector<std::string>; StrVec strVec = jArr.toStdArray<StrVec>(&json::Value::asString)
-		template<class StdCont, typename ValueMemFn> StdCont toStdArray(ValueMemFn valueMemFn) const
+		template<class StdCont, typename ValueMemFn, typename std::enable_if<std::is_member_function_pointer<ValueMemFn>::value, int>::type = 0>
+		StdCont toStdArray(ValueMemFn valueMemFn) const
 		{
 			StdCont ret;
 			ret.reserve(size());
@@ -273,6 +488,49 @@ namespace json
 				ret.emplace(((*this)[i].*valueMemFn)());
 			return ret;
 		}
+		//same with the container's allocator, which is also used for the elements of allocator aware types. E.g.:
+		// using StrVec=std::pmr::vector<std::pmr::string>; StrVec strVec = jArr.toStdArray<StrVec>(&json::Value::asString, &arena)
+		//asString() elements are built from c_str(), without std::string temporaries.
+		template<class StdCont, typename ValueMemFn> StdCont toStdArray(ValueMemFn valueMemFn, const typename StdCont::allocator_type& alloc) const
+		{
+			StdCont ret(alloc);
+			ret.reserve(size());
+			toStdElements(valueMemFn, [&ret](auto&& el) { ret.emplace_back(std::forward<decltype(el)>(el)); }, StrElements<StdCont, ValueMemFn>{});
+			return ret;
+		}
+		template<class StdCont> StdCont toStdArray(const typename StdCont::allocator_type& alloc) const
+		{
+			StdCont ret(alloc);
+			ret.reserve(size());
+			for (size_t i = 0, iEnd = size(); i != iEnd; ++i)
+				ret.emplace_back((*this)[i]);
+			return ret;
+		}
+		template<class StdCont, typename ValueMemFn> StdCont toStdSet(ValueMemFn valueMemFn, const typename StdCont::allocator_type& alloc) const
+		{
+			StdCont ret(alloc);
+			toStdElements(valueMemFn, [&ret](auto&& el) { ret.emplace(std::forward<decltype(el)>(el)); }, StrElements<StdCont, ValueMemFn>{});
+			return ret;
+		}
+	private:
+		template<class StdCont, typename ValueMemFn>
+		using StrElements = std::integral_constant<bool, std::is_same<ValueMemFn, std::string(Value::*)() const>::value
+			&& std::is_constructible<typename StdCont::value_type, const char*>::value>;
+		template<typename ValueMemFn, class EmplaceFn> void toStdElements(ValueMemFn valueMemFn, EmplaceFn emplace, std::true_type) const
+		{
+			const bool asString{ valueMemFn == &Value::asString };
+			for (size_t i = 0, iEnd = size(); i != iEnd; ++i)
+				if (asString)
+					emplace((*this)[i].c_str());
+				else
+					emplace(((*this)[i].*valueMemFn)());
+		}
+		template<typename ValueMemFn, class EmplaceFn> void toStdElements(ValueMemFn valueMemFn, EmplaceFn emplace, std::false_type) const
+		{
+			for (size_t i = 0, iEnd = size(); i != iEnd; ++i)
+				emplace(((*this)[i].*valueMemFn)());
+		}
+	public:
 
 		class iterator;
 		//helper class used as non-const (assign-able) ref to element.
@@ -310,6 +568,12 @@ namespace json
 		void insert(size_t idx, const Value& val);
 		void erase(size_t idx);
 		void clear();
+		//Persistent update of nested values: only the values along the path are (shallow) copied and only if shared. Anything
+		//else stays shared with any other copies (e.g. with older snapshots). Missing objects/arrays along the path are created,
+		//an array index equal to the array size appends. Setting an empty Value erases the field/element.
+		void setIn(const Path& path, const Value& val);
+		//fn gets the current value (isEmpty() if missing) and returns the new one (or empty Value to erase it)
+		void updateIn(const Path& path, const std::function<Value(const Value&)>& fn);
 
 		class ZJSON_EXP_IMP const_iterator
 		{
@@ -444,6 +708,12 @@ namespace json
 		bool erase(const char* key);
 		bool erase(const std::string& key) { return erase(key.c_str()); }
 		void clear();
+		//Persistent update of nested values: only the values along the path are (shallow) copied and only if shared. Anything
+		//else stays shared with any other copies (e.g. with older snapshots). Missing objects/arrays along the path are created,
+		//an array index equal to the array size appends. Setting an empty Value erases the field/element.
+		void setIn(const Path& path, const Value& val);
+		//fn gets the current value (isEmpty() if missing) and returns the new one (or empty Value to erase it)
+		void updateIn(const Path& path, const std::function<Value(const Value&)>& fn);
 
 		class ZJSON_EXP_IMP const_iterator : public std::forward_iterator_tag
 		{
@@ -480,6 +750,106 @@ namespace json
 		friend ZJSON_EXP_IMP std::istream& operator>>(std::istream& is, Object&);
 	};
 
+	//Batch evaluation of many paths over the same value(s). The common path prefixes are walked once.
+	class ZJSON_EXP_IMP PathSet
+	{
+	public:
+		//returns the index of the path value in the eval() results
+		size_t add(const Path& path);
+		size_t size() const { return m_pathsCnt; }
+		//values of all paths (in the order they were added), isEmpty() for the missing ones
+		std::vector<Value> eval(const Value& root) const;
+
+	private:
+		struct Node
+		{
+			std::vector<size_t> results;
+			std::vector<std::pair<Path::Step, size_t>> children;//step and index in m_nodes
+		};
+		std::vector<Node> m_nodes{ 1 };//[0] is the root
+		size_t m_pathsCnt{ 0 };
+
+		void evalNode(const Node& node, json_t* v, std::vector<Value>& results) const;
+	};
+
+	//Read only, position independent binary snapshot of a value, which is memory mapped and queried in place (no parsing or
+	//copying). The mapped pages are shared by all processes using the same snapshot file. Write it with writeSnapshot().
+	//Objects fields are found with binary search. Shared values and repeated object keys are stored once.
+	class ZJSON_EXP_IMP Snapshot
+	{
+	public:
+		//Read only accessors, named as the Value ones. Valid while the Snapshot (or any copy of it) is alive.
+		class ZJSON_EXP_IMP View
+		{
+		public:
+			View() {}
+			bool isEmpty() const { return !m_data; }
+			bool isNull() const;
+			bool isBool() const;
+			bool isInt() const;
+			bool isFloat() const;
+			bool isString() const;
+			bool isArray() const;
+			bool isObject() const;
+
+			bool asBool() const;
+			bool asBoolSafe() const { return isBool() && asBool(); }
+			int64_t asInt() const;
+			int64_t asIntSafe(int64_t def = 0ll) const { return isInt() ? asInt() : def; }
+			double asFloat() const;
+			double asFloatNum() const;//can be int or float
+			double asFloatSafe(double def = 0.) const { return isFloat() ? asFloat() : def; }
+			const char* c_str() const;
+			const char* c_strSafe(const char* def = "") const { return isString() ? c_str() : def; }
+			std::string asString() const { return c_str(); }
+			std::string asStringSafe(std::string def = {}) const { return isString() ? c_str() : def; }
+
+			bool empty() const { return isEmpty() ? true : 0 == size(); }
+			size_t size() const;//array or object
+			View operator[](size_t idx) const;//array element
+			View operator[](const char* key) const;//object field, isEmpty() if missing
+			View operator[](const std::string& key) const { return (*this)[key.c_str()]; }
+			bool hasField(const char* key) const { return !(*this)[key].isEmpty(); }
+			bool hasField(const std::string& key) const { return hasField(key.c_str()); }
+			//object fields in their original order, idx < size()
+			const char* keyAt(size_t idx) const;
+			View valueAt(size_t idx) const;
+			View getIn(const Path& path) const;
+
+			Value toValue() const;//regular (deep) copy
+
+		private:
+			friend class Snapshot;
+			View(const char* data, size_t sz, uint64_t off) : m_data(data), m_sz(sz), m_off(off) {}
+			const char* m_data{ nullptr };
+			size_t m_sz{ 0 };
+			uint64_t m_off{ 0 };
+
+			int type() const;
+			uint64_t u64(uint64_t off) const;
+			View at(uint64_t off) const;
+			void checkType(int type, const char* typeName) const;
+		};
+
+		static Snapshot open(const char* path);//memory map the file (read only)
+		static Snapshot open(const std::string& path) { return open(path.c_str()); }
+		static Snapshot fromMemory(const void* data, size_t sz);//the memory must outlive the Snapshot (and its Views)
+		View root() const { return m_root; }
+
+	private:
+		std::shared_ptr<const void> m_mapping;
+		View m_root;
+		Snapshot(std::shared_ptr<const void> mapping, const void* data, size_t sz);
+	};
+	ZJSON_EXP_IMP void writeSnapshot(const Value& val, std::ostream& os);
+
+	//RFC 7386 JSON merge patch from "from" to "to": objects are diffed field by field, anything else is replaced.
+	//Values shared by both (e.g. the unmodified parts of a copy) are skipped in O(1). Empty object if nothing changed.
+	//Note: a merge patch can not set fields to null (null means remove), so such fields are removed by applyPatch().
+	ZJSON_EXP_IMP Value diff(const Value& from, const Value& to);
+	//Apply RFC 7386 JSON merge patch. Only the patched nested values are modified (i.e. copied if shared).
+	ZJSON_EXP_IMP void applyPatch(Value& target, const Value& patch);
+
 	//tabulated output: os << json::setOStreamIdent(4)
 	struct ZJSON_EXP_IMP setOStreamIdent
 	{
@@ -495,6 +865,29 @@ namespace json
 	//sorted objects fields output: os << json::setOStreamSorted
 	ZJSON_EXP_IMP std::ostream& setOStreamSorted(std::ostream& os);
 
+	//RFC 8785 (JSON Canonicalization Scheme) output, for signatures and content addressing: os << json::setOStreamCanonical
+	//Compact, keys sorted by their UTF16 code units, minimal string escaping and numbers formatted as ECMAScript does
+	//(hence integers beyond 2^53 as their nearest doubles). Overrides the indentation, sorting and parallel output.
+	ZJSON_EXP_IMP std::ostream& setOStreamCanonical(std::ostream& os);
+	//Per thread. Cache the canonical key order of the objects with many keys, the same way as setHashCaching(), so that
+	//repeated output of mostly unchanged values does not sort them again. Costs a key pointer per member while cached.
+	ZJSON_EXP_IMP void setCanonicalCaching(bool enable);
+	ZJSON_EXP_IMP std::string toCanonicalString(const Value& val);
+	//SHA-256 of the canonical output, hashed while serializing (the output is not kept)
+	ZJSON_EXP_IMP std::array<uint8_t, 32> canonicalSha256(const Value& val);
+
+	//parallel output of big arrays and objects, the same bytes as the serial one: os << json::setOStreamParallel(8)
+	struct ZJSON_EXP_IMP setOStreamParallel
+	{
+		//Construct with 0 for all the cores, 1 for serial output
+		setOStreamParallel(unsigned threads = 0) : m_threads(threads) {}
+		friend ZJSON_EXP_IMP std::ostream& operator<<(std::ostream& os, const setOStreamParallel& parallel);
+
+	private:
+		const unsigned m_threads;
+	};
+	ZJSON_EXP_IMP std::ostream& operator<<(std::ostream& os, const setOStreamParallel& parallel);
+
 	//currently used only for dumping values. Ignore output failures (e.g. invalid UTF8) instead of throwing: os << json::setIgnoreOutErrs
 	ZJSON_EXP_IMP std::ostream& setIgnoreOutErrs(std::ostream& os);
 
@@ -513,9 +906,408 @@ namespace json
 		return os.str();
 	}
 
+	//Writes JSON straight to an ostream (or appends to a string) without building the Values first:
+	//	json::StreamWriter w{ os }; w.beginObject().key("ids").beginArray().value(1).value(2).endArray().key("obj").value(jObj).endObject();
+	//Stream indentation (setOStreamIdent) is used. Sorting (setOStreamSorted) applies to the embedded Values only,
+	//the written keys are output in the call order. Nesting errors throw Exc in debug builds (an end or key() without an open
+	//level in all builds).
+	class ZJSON_EXP_IMP StreamWriter
+	{
+	public:
+		explicit StreamWriter(std::ostream& os);
+		explicit StreamWriter(std::string& out, bool sortIt = false, int identSpaces = 0);
+		~StreamWriter();//flushes
+		StreamWriter(const StreamWriter&) = delete;
+		StreamWriter& operator=(const StreamWriter&) = delete;
+
+		StreamWriter& beginObject();
+		StreamWriter& endObject();
+		StreamWriter& beginArray();
+		StreamWriter& endArray();
+		StreamWriter& key(const char* key);
+		StreamWriter& key(const std::string& key) { return this->key(key.c_str()); }
+		StreamWriter& value(const Value& val);//existing value (not copied)
+		StreamWriter& value(const char* str);
+		StreamWriter& value(const std::string& str);
+		StreamWriter& value(bool b);
+		StreamWriter& value(double d);//throws for NaN and infinity
+		template<class Int, typename std::enable_if<std::is_integral<Int>::value && !std::is_same<Int, bool>::value, int>::type = 0>
+		StreamWriter& value(Int i) { return std::is_signed<Int>::value ? intValue(int64_t(i)) : uintValue(uint64_t(i)); }//throws above INT64_MAX
+		StreamWriter& null();
+		void flush();//ostream only, appended strings are always up to date
+
+	private:
+		struct Impl;
+		std::unique_ptr<Impl> m_impl;
+		StreamWriter& intValue(int64_t i);
+		StreamWriter& uintValue(uint64_t u);
+	};
+
+	namespace detail
+	{
+		//streambuf appending to a string (of any allocator)
+		template<class Str>
+		class StringAppendBuf : public std::streambuf
+		{
+		public:
+			explicit StringAppendBuf(Str& str) : m_str(str) {}
+
+		protected:
+			int_type overflow(int_type c) override
+			{
+				if (!traits_type::eq_int_type(c, traits_type::eof()))
+					m_str.push_back(traits_type::to_char_type(c));
+				return traits_type::not_eof(c);
+			}
+			std::streamsize xsputn(const char* s, std::streamsize n) override
+			{
+				m_str.append(s, size_t(n));
+				return n;
+			}
+
+		private:
+			Str& m_str;
+		};
+	}
+	//jsonToString() straight into a string with the given allocator (the serializer writes through it in 64KB chunks)
+	template<class jObjOrArr, class Alloc, class = typename Alloc::value_type>
+	inline std::basic_string<char, std::char_traits<char>, Alloc> jsonToString(const jObjOrArr& jSmthing, const Alloc& alloc, bool sortIt = false, int identSpaces = 0)
+	{
+		std::basic_string<char, std::char_traits<char>, Alloc> ret(alloc);
+		detail::StringAppendBuf<std::basic_string<char, std::char_traits<char>, Alloc>> buf(ret);
+		std::ostream os(&buf);
+		if (sortIt)
+			os << setOStreamSorted;
+		if (0 != identSpaces)
+			os << setOStreamIdent(identSpaces);
+		os << jSmthing;
+		return ret;
+	}
+#if defined(ZJSON_PMR)
+	template<class jObjOrArr>
+	inline std::pmr::string jsonToString(const jObjOrArr& jSmthing, std::pmr::memory_resource* resource, bool sortIt = false, int identSpaces = 0)
+	{
+		return jsonToString(jSmthing, std::pmr::polymorphic_allocator<char>(resource), sortIt, identSpaces);
+	}
+#endif
+
+	//Output template compiled once from a value with placeholders, i.e. string values "{{name}}" (not keys), at any depth:
+	//	json::Template tmpl{ json::Object{ {"status", "ok"}, {"id", "{{id}}"}, {"data", "{{data}}"} } };
+	//	const size_t ID{ tmpl.slot("id") }, DATA{ tmpl.slot("data") };//once
+	//	std::vector<json::Value> vals(tmpl.slotCount()); vals[ID] = 42; vals[DATA] = jData; tmpl.render(out, vals);
+	//All the static parts are serialized at construction, rendering outputs only the slot values between them.
+	//Same output as os << filled value (with the given sorting and indentation). Immutable, cheap to copy, thread safe.
+	class ZJSON_EXP_IMP Template
+	{
+	public:
+		explicit Template(const Value& proto, bool sortIt = false, int identSpaces = 0);
+		size_t slotCount() const;
+		size_t slot(const char* name) const;//throws Exc for unknown names
+		const std::string& slotName(size_t idx) const;
+		//appends to out. values are indexed by slot(), all must be set (not isEmpty())
+		void render(std::string& out, const std::vector<Value>& values) const;
+		std::string render(std::initializer_list<std::pair<const char*, Value>> values) const;
+
+	private:
+		struct Impl;
+		std::shared_ptr<const Impl> m_impl;
+	};
+
 	ZJSON_EXP_IMP std::istream& operator>>(std::istream& is, Array& arrVal);
 	ZJSON_EXP_IMP std::istream& operator>>(std::istream& is, Object& objVal);
 
+	//Reads the elements of a top-level array (or the members of a top-level object) one by one while reading the
+	//stream, the memory is bounded by the biggest element:
+	//	json::ElementReader reader{ is }; for (const json::Value& el : reader) ...;//reader.key() for object members
+	//Invalid JSON throws Exc (positions are in the whole stream), the elements before it are still read.
+	class ZJSON_EXP_IMP ElementReader
+	{
+	public:
+		explicit ElementReader(std::istream& is);
+		~ElementReader();
+		ElementReader(const ElementReader&) = delete;
+		ElementReader& operator=(const ElementReader&) = delete;
+
+		bool next(Value& val);//false after the last element
+		const std::string& key() const;//of the last object member read
+		bool isObject() const;//known after the first next()
+
+		class iterator
+		{
+		public:
+			using iterator_category = std::input_iterator_tag;
+			using value_type = Value;
+			using difference_type = std::ptrdiff_t;
+			using pointer = const Value*;
+			using reference = const Value&;
+
+			iterator() = default;
+			explicit iterator(ElementReader* reader) : m_reader(reader) { ++*this; }
+			const Value& operator*() const { return m_val; }
+			const Value* operator->() const { return &m_val; }
+			iterator& operator++()
+			{
+				if (!m_reader->next(m_val))
+					m_reader = nullptr;
+				return *this;
+			}
+			bool operator==(const iterator& rhs) const { return m_reader == rhs.m_reader; }
+			bool operator!=(const iterator& rhs) const { return m_reader != rhs.m_reader; }
+
+		private:
+			ElementReader* m_reader{ nullptr };
+			Value m_val;
+		};
+		iterator begin() { return iterator(this); }
+		iterator end() { return iterator(); }
+
+	private:
+		struct Impl;
+		std::unique_ptr<Impl> m_impl;
+	};
+
+#if defined(ZJSON_COROUTINES)
+	//Coroutine generator over an ElementReader: for (json::Value& el : json::readElements(is)) ...
+	template<class T>
+	class Generator
+	{
+	public:
+		struct promise_type
+		{
+			T* current{ nullptr };
+			std::exception_ptr error;
+
+			Generator get_return_object() { return Generator(std::coroutine_handle<promise_type>::from_promise(*this)); }
+			std::suspend_always initial_suspend() noexcept { return {}; }
+			std::suspend_always final_suspend() noexcept { return {}; }
+			std::suspend_always yield_value(T& val) noexcept
+			{
+				current = &val;
+				return {};
+			}
+			void return_void() {}
+			void unhandled_exception() { error = std::current_exception(); }
+		};
+		class iterator
+		{
+		public:
+			using iterator_category = std::input_iterator_tag;
+			using value_type = T;
+			using difference_type = std::ptrdiff_t;
+
+			iterator() = default;
+			explicit iterator(std::coroutine_handle<promise_type> coro) : m_coro(coro) { resume(); }
+			T& operator*() const { return *m_coro.promise().current; }
+			iterator& operator++()
+			{
+				resume();
+				return *this;
+			}
+			void operator++(int) { resume(); }
+			bool operator==(std::default_sentinel_t) const { return !m_coro; }
+
+		private:
+			std::coroutine_handle<promise_type> m_coro;
+
+			void resume()
+			{
+				m_coro.resume();
+				if (m_coro.done())
+				{
+					const std::exception_ptr error{ m_coro.promise().error };
+					m_coro = nullptr;
+					if (error)
+						std::rethrow_exception(error);
+				}
+			}
+		};
+
+		Generator(Generator&& rhs) noexcept : m_coro(std::exchange(rhs.m_coro, nullptr)) {}
+		Generator(const Generator&) = delete;
+		Generator& operator=(const Generator&) = delete;
+		~Generator()
+		{
+			if (m_coro)
+				m_coro.destroy();
+		}
+		iterator begin() { return iterator(m_coro); }//once
+		std::default_sentinel_t end() { return {}; }
+
+	private:
+		explicit Generator(std::coroutine_handle<promise_type> coro) : m_coro(coro) {}
+		std::coroutine_handle<promise_type> m_coro;
+	};
+
+	//Elements of a top-level array (or the values of a top-level object)
+	inline Generator<Value> readElements(std::istream& is)
+	{
+		ElementReader reader{ is };
+		Value val;
+		while (reader.next(val))
+			co_yield val;
+	}
+
+	//Members of a top-level object (the keys are empty for an array)
+	inline Generator<std::pair<std::string, Value>> readMembers(std::istream& is)
+	{
+		ElementReader reader{ is };
+		std::pair<std::string, Value> member;
+		while (reader.next(member.second))
+		{
+			member.first = reader.key();
+			co_yield member;
+		}
+	}
+#endif
+
+#if defined(ZJSON_HAS_ZLIB) || defined(ZJSON_HAS_ZSTD)
+	//Compressed streams (optional CMake component, ZJSON_HAS_ZLIB/ZJSON_HAS_ZSTD defined for the available libraries),
+	//to be used with the stream operators above: data is (de)compressed chunk by chunk, without a full size buffer.
+	//	json::CompressedIStream is{ fileStream }; is >> jObj;
+	//	json::CompressedOStream os{ fileStream, json::Compression::Zstd }; os << jObj; os.finish();
+	enum class Compression
+	{
+		Gzip,//zlib
+		Zstd
+	};
+
+	//Decompress from src. The format (gzip, zlib or zstd) is detected from the data. Concatenated streams are read as one.
+	//Corrupted or truncated data fails the stream (i.e. the deserialization).
+	class ZJSON_EXP_IMP CompressedIStreamBuf : public std::streambuf
+	{
+	public:
+		explicit CompressedIStreamBuf(std::istream& src);
+		~CompressedIStreamBuf();
+		CompressedIStreamBuf(const CompressedIStreamBuf&) = delete;
+		CompressedIStreamBuf& operator=(const CompressedIStreamBuf&) = delete;
+
+	protected:
+		int_type underflow() override;
+
+	private:
+		struct Impl;
+		std::unique_ptr<Impl> m_impl;
+	};
+
+	//Compress into dst. finish() (or the destructor, ignoring errors) writes the end of the compressed stream.
+	//Flushing (e.g. std::endl) only passes the buffered data to the compressor, which decides when to output it.
+	class ZJSON_EXP_IMP CompressedOStreamBuf : public std::streambuf
+	{
+	public:
+		CompressedOStreamBuf(std::ostream& dst, Compression compression, int level = -1);//-1: default level of the library
+		~CompressedOStreamBuf();
+		CompressedOStreamBuf(const CompressedOStreamBuf&) = delete;
+		CompressedOStreamBuf& operator=(const CompressedOStreamBuf&) = delete;
+		bool finish();
+
+	protected:
+		int_type overflow(int_type c) override;
+		int sync() override;
+
+	private:
+		struct Impl;
+		std::unique_ptr<Impl> m_impl;
+		bool compress(bool end);
+	};
+
+	class CompressedIStream : public std::istream
+	{
+	public:
+		explicit CompressedIStream(std::istream& src) : std::istream(nullptr), m_buf(src) { rdbuf(&m_buf); }
+
+	private:
+		CompressedIStreamBuf m_buf;
+	};
+
+	class CompressedOStream : public std::ostream
+	{
+	public:
+		CompressedOStream(std::ostream& dst, Compression compression, int level = -1) : std::ostream(nullptr), m_buf(dst, compression, level) { rdbuf(&m_buf); }
+		//Write the end of the compressed stream. Sets badbit on failure.
+		CompressedOStream& finish() { if (!m_buf.finish()) setstate(std::ios_base::badbit); return *this; }
+
+	private:
+		CompressedOStreamBuf m_buf;
+	};
+#endif
+
+	//Binary encodings (MessagePack and CBOR) with one to one mapping of the json types. Encoding appends to out.
+	//Decoding reads straight from the caller's memory (no extra mem copy) and throws Exc on malformed input or types
+	//without json equivalent (e.g. binary data, integers above int64 max). Non string map keys are not supported.
+	ZJSON_EXP_IMP void toMsgPack(const Value& val, std::string& out);
+	inline std::string toMsgPack(const Value& val) { std::string ret; toMsgPack(val, ret); return ret; }
+	ZJSON_EXP_IMP Value fromMsgPack(const void* data, size_t sz);
+	inline Value fromMsgPack(const std::string& data) { return fromMsgPack(data.data(), data.size()); }
+	ZJSON_EXP_IMP void toCbor(const Value& val, std::string& out);
+	inline std::string toCbor(const Value& val) { std::string ret; toCbor(val, ret); return ret; }
+	ZJSON_EXP_IMP Value fromCbor(const void* data, size_t sz);
+	inline Value fromCbor(const std::string& data) { return fromCbor(data.data(), data.size()); }
+
+	//Parse an object or array straight from the memory mapped file (read in large chunks if it can not be mapped)
+	ZJSON_EXP_IMP Value loadFile(const char* path);
+	inline Value loadFile(const std::string& path) { return loadFile(path.c_str()); }
+	//Serialize in large buffers to a temporary file next to path, flush it to the disk and rename it over path.
+	//The target is either the old or the complete new file, even on a crash. Throws Exc on any failure.
+	ZJSON_EXP_IMP void saveFile(const char* path, const Value& val, bool sortIt = false, int identSpaces = 0);
+	inline void saveFile(const std::string& path, const Value& val, bool sortIt = false, int identSpaces = 0) { saveFile(path.c_str(), val, sortIt, identSpaces); }
+
+	//UTF8 validation (same rules as jansson), vectorized for the ASCII runs
+	ZJSON_EXP_IMP bool isValidUtf8(const char* str, size_t sz);
+	//all the strings and keys of val, e.g. before an output with setIgnoreOutErrs (which would be cut at the invalid string)
+	ZJSON_EXP_IMP bool hasValidUtf8(const Value& val);
+	//Opt-in (process wide) validation of the strings and keys set from C++ (Value(const char*), Object::operator[], setIn...):
+	//invalid UTF8 throws Exc there, instead of failing the output later. The parsed strings are always validated by jansson.
+	ZJSON_EXP_IMP void setStringValidation(bool on);
+
+	//Parse a big object or array on several threads (0: hardware concurrency). A quick structural pre-scan splits the
+	//array/object (or its largest member, nested up to a few levels) at element boundaries, the parts are parsed
+	//concurrently and joined in order. Same result and errors (Exc) as the serial parsing, which small inputs use.
+	ZJSON_EXP_IMP Value parseParallel(const char* cStr, size_t sz, unsigned threads = 0);
+	inline Value parseParallel(const std::string& strJ, unsigned threads = 0) { return parseParallel(strJ.c_str(), strJ.size(), threads); }
+
+	//Parse an object or array without throwing (nor allocating) on malformed input
+	ZJSON_EXP_IMP Expected<Value> tryParse(const char* cStr, size_t sz);
+	inline Expected<Value> tryParse(const std::string& strJ) { return tryParse(strJ.c_str(), strJ.size()); }
+
+	//Limits for untrusted input (0: unlimited), checked while the input is read, i.e. the parsing stops as soon as one is
+	//exceeded (within the 1KB read ahead of the parser). The error code tells which one (and the position where).
+	struct ParseLimits
+	{
+		size_t maxDepth{ 0 };
+		size_t maxBytes{ 0 };//estimated DOM size (as Value::memoryUsage(): jansson 2.14 64 bit sizes, no malloc overhead)
+		size_t maxStringLength{ 0 };//keys included. UTF8 bytes of the parsed (unescaped) string
+		size_t maxElements{ 0 };//per array or object
+		size_t maxKeys{ 0 };//per object
+	};
+	ZJSON_EXP_IMP Expected<Value> tryParse(const char* cStr, size_t sz, const ParseLimits& limits);
+	inline Expected<Value> tryParse(const std::string& strJ, const ParseLimits& limits) { return tryParse(strJ.c_str(), strJ.size(), limits); }
+	//Throw Exc if a limit is exceeded (or on malformed input)
+	ZJSON_EXP_IMP Object strToObject(const char* cStr, size_t sz, const ParseLimits& limits);
+	inline Object strToObject(const std::string& strJ, const ParseLimits& limits) { return strToObject(strJ.c_str(), strJ.size(), limits); }
+	ZJSON_EXP_IMP Array strToArray(const char* cStr, size_t sz, const ParseLimits& limits);
+	inline Array strToArray(const std::string& strJ, const ParseLimits& limits) { return strToArray(strJ.c_str(), strJ.size(), limits); }
+
+	//Compiled JSON Schema subset: type, enum, const, properties, required, additionalProperties, items, minItems, maxItems,
+	//minProperties, maxProperties, minimum, maximum, exclusiveMinimum, exclusiveMaximum (numbers), minLength, maxLength,
+	//pattern (std::regex ECMAScript, unanchored). Annotations (title, description, default, ...) are ignored, other keywords
+	//throw Exc. Objects are validated in one pass over their fields with the property keys hashed at compile time.
+	//Cheap to copy (the compiled schema is shared) and thread safe.
+	class ZJSON_EXP_IMP Schema
+	{
+	public:
+		explicit Schema(const Value& schema);
+		//why (if given) gets "<JSON pointer>: <reason>" of the first violation
+		bool validate(const Value& val, std::string* why = nullptr) const;
+		//Parse and validate: types, additionalProperties false and maxItems are checked while reading, i.e. such documents
+		//are rejected before the DOM is complete. Only the subtrees with other checks (enum, const, integer, bounds, string
+		//length and pattern, maxProperties and required since duplicate keys are counted once) are then walked. Errc::Invalid
+		Expected<Value> parse(const char* cStr, size_t sz, std::string* why = nullptr, const ParseLimits& limits = {}) const;
+		Expected<Value> parse(const std::string& strJ, std::string* why = nullptr, const ParseLimits& limits = {}) const { return parse(strJ.c_str(), strJ.size(), why, limits); }
+
+	private:
+		struct Impl;
+		std::shared_ptr<const Impl> m_impl;
+	};
 	ZJSON_EXP_IMP Object strToObject(const char* cStr, size_t sz);//no extra mem copy
 	ZJSON_EXP_IMP inline Object strToObject(const std::string& strJ) { return strToObject(strJ.c_str(), strJ.size()); }
 	ZJSON_EXP_IMP Array strToArray(const char* cStr, size_t sz);//no extra mem copy
@@ -524,8 +1316,285 @@ namespace json
 	ZJSON_EXP_IMP inline void stringToJson(const char* cStr, size_t sz, Array& jA) { jA = strToArray(cStr, sz); }
 	template<class ObjOrArr>
 	inline void stringToJson(const std::string& strJ, ObjOrArr& j) { stringToJson(strJ.c_str(), strJ.size(), j); }
+
+#if defined(ZJSON_CPP20)
+	namespace detail
+	{
+		template<size_t N>
+		struct FixedString
+		{
+			char data[N]{};
+			constexpr FixedString(const char (&str)[N])
+			{
+				for (size_t i = 0; i != N; ++i)
+					data[i] = str[i];
+			}
+			constexpr size_t size() const { return N - 1; }
+		};
+
+		//Compile time check of what the parser accepts: an object or array (nested up to 2048 levels, as jansson),
+		//UTF8 strings without \u0000, integers in the int64 range. Reals overflowing a double are only caught at runtime.
+		class LiteralChecker
+		{
+		public:
+			constexpr LiteralChecker(const char* s, size_t sz) : m_s(s), m_sz(sz) {}
+			constexpr bool check()
+			{
+				bool isObject[MAX_DEPTH]{};
+				size_t depth{ 0 };
+				ws();
+				if (m_pos == m_sz || ('{' != m_s[m_pos] && '[' != m_s[m_pos]))
+					return false;
+				for (;;)
+				{//at a value
+					ws();
+					if (m_pos == m_sz)
+						return false;
+					const char c{ m_s[m_pos] };
+					if ('{' == c || '[' == c)
+					{
+						if (MAX_DEPTH == depth)
+							return false;
+						isObject[depth++] = '{' == c;
+						++m_pos;
+						ws();
+						if (m_pos == m_sz)
+							return false;
+						if (('{' == c ? '}' : ']') != m_s[m_pos])
+						{
+							if ('{' == c && !key())
+								return false;
+							continue;
+						}
+						++m_pos;
+						--depth;
+					}
+					else if (!scalar())
+						return false;
+					for (;;)
+					{//after a value
+						ws();
+						if (0 == depth)
+							return m_pos == m_sz;
+						if (m_pos == m_sz)
+							return false;
+						if (',' == m_s[m_pos])
+						{
+							++m_pos;
+							if (isObject[depth - 1] && !key())
+								return false;
+							break;
+						}
+						if ((isObject[depth - 1] ? '}' : ']') != m_s[m_pos])
+							return false;
+						++m_pos;
+						--depth;
+					}
+				}
+			}
+
+		private:
+			static constexpr size_t MAX_DEPTH{ 2048 };
+			const char* m_s;
+			size_t m_sz;
+			size_t m_pos{ 0 };
+
+			constexpr unsigned char at(size_t pos) const { return pos < m_sz ? (unsigned char)m_s[pos] : 0; }
+			constexpr void ws()
+			{
+				while (' ' == at(m_pos) || '\t' == at(m_pos) || '\n' == at(m_pos) || '\r' == at(m_pos))
+					++m_pos;
+			}
+			constexpr bool key()
+			{
+				ws();
+				if ('"' != at(m_pos) || !string())
+					return false;
+				ws();
+				if (':' != at(m_pos))
+					return false;
+				++m_pos;
+				return true;
+			}
+			constexpr bool scalar()
+			{
+				const unsigned char c{ at(m_pos) };
+				if ('"' == c)
+					return string();
+				if ('-' == c || ('0' <= c && '9' >= c))
+					return number();
+				return word("true") || word("false") || word("null");
+			}
+			constexpr bool word(const char* w)
+			{
+				size_t len{ 0 };
+				while (w[len])
+					++len;
+				for (size_t i = 0; i != len; ++i)
+					if (at(m_pos + i) != (unsigned char)w[i])
+						return false;
+				m_pos += len;
+				return true;
+			}
+			constexpr bool digits()
+			{
+				const size_t start{ m_pos };
+				while ('0' <= at(m_pos) && '9' >= at(m_pos))
+					++m_pos;
+				return start != m_pos;
+			}
+			constexpr bool number()
+			{
+				const bool negative{ '-' == at(m_pos) };
+				if (negative)
+					++m_pos;
+				const size_t intStart{ m_pos };
+				if ('0' == at(m_pos))
+					++m_pos;
+				else if (!digits())
+					return false;
+				const size_t intEnd{ m_pos };
+				bool isReal{ false };
+				if ('.' == at(m_pos))
+				{
+					++m_pos;
+					if (!digits())
+						return false;
+					isReal = true;
+				}
+				if ('e' == at(m_pos) || 'E' == at(m_pos))
+				{
+					++m_pos;
+					if ('+' == at(m_pos) || '-' == at(m_pos))
+						++m_pos;
+					if (!digits())
+						return false;
+					isReal = true;
+				}
+				if (isReal)
+					return true;
+				const char* const LIMIT{ negative ? "9223372036854775808" : "9223372036854775807" };
+				if (19 != intEnd - intStart)
+					return 19 > intEnd - intStart;
+				for (size_t i = 0; i != 19; ++i)
+					if (at(intStart + i) != (unsigned char)LIMIT[i])
+						return at(intStart + i) < (unsigned char)LIMIT[i];
+				return true;
+			}
+			constexpr bool hex4(unsigned& code)
+			{
+				code = 0;
+				for (size_t i = 0; i != 4; ++i, ++m_pos)
+				{
+					const unsigned char c{ at(m_pos) };
+					const unsigned digit = '0' <= c && '9' >= c ? c - '0' : 'a' <= c && 'f' >= c ? c - 'a' + 10 : 'A' <= c && 'F' >= c ? c - 'A' + 10 : 16;
+					if (16 == digit)
+						return false;
+					code = code * 16 + digit;
+				}
+				return true;
+			}
+			constexpr bool string()
+			{
+				++m_pos;
+				for (;;)
+				{
+					if (m_pos >= m_sz)
+						return false;
+					const unsigned char c{ at(m_pos) };
+					if ('"' == c)
+					{
+						++m_pos;
+						return true;
+					}
+					if (0x20 > c)
+						return false;
+					if ('\\' == c)
+					{
+						const unsigned char esc{ at(++m_pos) };
+						++m_pos;
+						if ('u' == esc)
+						{
+							unsigned code{ 0 };
+							if (!hex4(code) || 0 == code || (0xDC00 <= code && 0xDFFF >= code))
+								return false;
+							if (0xD800 <= code && 0xDBFF >= code)
+							{//surrogate pair
+								if ('\\' != at(m_pos) || 'u' != at(m_pos + 1))
+									return false;
+								m_pos += 2;
+								if (!hex4(code) || 0xDC00 > code || 0xDFFF < code)
+									return false;
+							}
+						}
+						else if ('"' != esc && '\\' != esc && '/' != esc && 'b' != esc && 'f' != esc && 'n' != esc && 'r' != esc && 't' != esc)
+							return false;
+						continue;
+					}
+					if (0x80 > c)
+					{
+						++m_pos;
+						continue;
+					}
+					size_t len{ 0 };
+					unsigned code{ 0 };
+					if (0xC2 <= c && 0xDF >= c)
+						len = 2, code = c & 0x1F;
+					else if (0xE0 <= c && 0xEF >= c)
+						len = 3, code = c & 0x0F;
+					else if (0xF0 <= c && 0xF4 >= c)
+						len = 4, code = c & 0x07;
+					else
+						return false;
+					for (size_t i = 1; i != len; ++i)
+					{
+						if (0x80 != (at(m_pos + i) & 0xC0))
+							return false;
+						code = (code << 6) | (at(m_pos + i) & 0x3F);
+					}
+					if ((3 == len && (0x800 > code || (0xD800 <= code && 0xDFFF >= code))) || (4 == len && (0x10000 > code || 0x10FFFF < code)))
+						return false;
+					m_pos += len;
+				}
+			}
+		};
+		consteval bool isJsonLiteral(const char* s, size_t sz) { return LiteralChecker(s, sz).check(); }
+	}
+
+	namespace literals
+	{
+		//Compile time checked JSON literal (a syntax error is a compile error). Only the syntax is checked at compile time: the
+		//jansson nodes are heap allocated, so the text is still parsed at run time, once per thread, on the first use. The
+		//Values returned to a thread then share its copy (copy on write), as Values are not thread safe. Within a
+		//MemoryResourceScope, that first use allocates the thread's copy from the scope's resource, which must hence outlive
+		//the thread: use it before entering the scope.
+		//	using namespace json::literals; const auto jDefs{ R"({"retries":3})"_json };
+		template<detail::FixedString S>
+		Value operator""_json()
+		{
+			static_assert(detail::isJsonLiteral(S.data, S.size()), "invalid JSON literal");
+			static thread_local const Value val{ tryParse(S.data, S.size()).value() };
+			return val;
+		}
+	}
+#endif
 }//namespace json
 
+#if defined(ZJSON_INLINE_ACCESSORS)
+#include "zjson_inline.h"
+#endif
+
+//json values as keys of unordered containers, e.g. std::unordered_set<json::Object>
+namespace std
+{
+	template<> struct hash<json::Value>
+	{
+		size_t operator()(const json::Value& v) const { return v.hash(); }
+	};
+	template<> struct hash<json::Array> : hash<json::Value> {};
+	template<> struct hash<json::Object> : hash<json::Value> {};
+}
+
 /*Might be possible to use as header only, but that means adding
 * jansson header(s) to the public interface (slow compile & include/link deps).
 * To do so, each definition in the cpp must be prefixed with ZJSON_INLINE
@@ -0,0 +1,189 @@
+#pragma once
+//Inline type checks, scalar accessors and refcounting (ZJSON_INLINE_ACCESSORS). Included by zjson.h only.
+//Mirrors the jansson 2.14 node layout, so that the hot accessors compile down to a few instructions without adding
+//jansson to the public interface. Only json_t and the enums are public (checked when zjson.cpp is built): the other
+//node structs come from jansson's private headers, hence zjson.cpp requires exactly that version.
+
+namespace json
+{
+	namespace detail
+	{
+		enum NodeType : int//json_type
+		{
+			NODE_OBJECT,
+			NODE_ARRAY,
+			NODE_STRING,
+			NODE_INTEGER,
+			NODE_REAL,
+			NODE_TRUE,
+			NODE_FALSE,
+			NODE_NULL
+		};
+		struct Node//json_t
+		{
+			NodeType type;
+			volatile size_t refcount;
+		};
+		struct StringNode//json_string_t
+		{
+			Node node;
+			char* value;
+			size_t length;
+		};
+		struct IntegerNode//json_integer_t
+		{
+			Node node;
+			long long value;
+		};
+		struct RealNode//json_real_t
+		{
+			Node node;
+			double value;
+		};
+		struct ArrayNode//json_array_t
+		{
+			Node node;
+			size_t size;
+			size_t entries;
+			json_t** table;
+		};
+		struct ObjectNode//json_object_t (the hashtable starts with its size)
+		{
+			Node node;
+			size_t size;
+		};
+
+		inline const Node* node(const json_t* v) { return reinterpret_cast<const Node*>(v); }
+		inline bool isType(const json_t* v, NodeType type) { return v && type == node(v)->type; }
+		ZJSON_EXP_IMP void deleteNode(json_t* v);//json_delete
+
+#if defined(__GNUC__)//same atomics as jansson
+		inline json_t* incRef(json_t* v)
+		{
+			Node* n = reinterpret_cast<Node*>(v);
+			if (n && size_t(-1) != n->refcount)
+				__atomic_add_fetch(&n->refcount, 1, __ATOMIC_ACQUIRE);
+			return v;
+		}
+		inline void decRef(json_t* v)
+		{
+			Node* n = reinterpret_cast<Node*>(v);
+			if (n && size_t(-1) != n->refcount && 0 == __atomic_sub_fetch(&n->refcount, 1, __ATOMIC_RELEASE))
+				deleteNode(v);
+		}
+#else
+		ZJSON_EXP_IMP json_t* incRef(json_t* v);
+		ZJSON_EXP_IMP void decRef(json_t* v);
+#endif
+	}
+
+	inline Value::Value(const Value& rhs) : m_val(detail::incRef(rhs.m_val)) {}
+
+	inline Value::~Value()
+	{
+		detail::decRef(m_val);
+	}
+
+	inline void Value::reset(Value&& rhs)
+	{
+		if (m_val == rhs.m_val)
+			return;
+		detail::decRef(m_val);
+		m_val = rhs.m_val;
+		rhs.m_val = nullptr;
+	}
+
+	inline void Value::reset(const Value& rhs)
+	{
+		if (m_val == rhs.m_val)
+			return;
+		detail::decRef(m_val);
+		m_val = detail::incRef(rhs.m_val);
+	}
+
+	inline bool Value::isNull() const { return detail::isType(m_val, detail::NODE_NULL); }
+	inline bool Value::isBool() const { return detail::isType(m_val, detail::NODE_TRUE) || detail::isType(m_val, detail::NODE_FALSE); }
+	inline bool Value::isInt() const { return detail::isType(m_val, detail::NODE_INTEGER); }
+	inline bool Value::isFloat() const { return detail::isType(m_val, detail::NODE_REAL); }
+	inline bool Value::isString() const { return detail::isType(m_val, detail::NODE_STRING); }
+	inline bool Value::isArray() const { return detail::isType(m_val, detail::NODE_ARRAY); }
+	inline bool Value::isObject() const { return detail::isType(m_val, detail::NODE_OBJECT); }
+
+	inline bool Value::asBool() const
+	{
+		if (!isBool())
+			onCastErr("boolean");
+		return detail::NODE_TRUE == detail::node(m_val)->type;
+	}
+
+	inline bool Value::asBoolSafe() const
+	{
+		return detail::isType(m_val, detail::NODE_TRUE);
+	}
+
+	inline int64_t Value::asInt() const
+	{
+		if (!isInt())
+			onCastErr("integer");
+		return reinterpret_cast<const detail::IntegerNode*>(m_val)->value;
+	}
+
+	inline int64_t Value::asIntNum() const
+	{
+		if (isInt())
+			return reinterpret_cast<const detail::IntegerNode*>(m_val)->value;
+		else if (isFloat())
+			return int64_t(reinterpret_cast<const detail::RealNode*>(m_val)->value + 0.5);
+		else
+			return onCastErr("integer_num"), 0;
+	}
+
+	inline int64_t Value::asIntSafe(int64_t def /*= 0ll*/) const
+	{
+		return isInt() ? reinterpret_cast<const detail::IntegerNode*>(m_val)->value : def;
+	}
+
+	inline double Value::asFloat() const
+	{
+		if (!isFloat())
+			onCastErr("float");
+		return reinterpret_cast<const detail::RealNode*>(m_val)->value;
+	}
+
+	inline double Value::asFloatNum() const
+	{
+		if (isInt())
+			return double(reinterpret_cast<const detail::IntegerNode*>(m_val)->value);
+		else if (isFloat())
+			return reinterpret_cast<const detail::RealNode*>(m_val)->value;
+		else
+			return onCastErr("float_num"), 0;
+	}
+
+	inline double Value::asFloatSafe(double def /*= 0.*/) const
+	{
+		return isFloat() ? reinterpret_cast<const detail::RealNode*>(m_val)->value : def;
+	}
+
+	inline const char* Value::c_str() const
+	{
+		if (!isString())
+			onCastErr("string");
+		return reinterpret_cast<const detail::StringNode*>(m_val)->value;
+	}
+
+	inline const char* Value::c_strSafe(const char* def /*= ""*/) const
+	{
+		return isString() ? reinterpret_cast<const detail::StringNode*>(m_val)->value : def;
+	}
+
+	inline size_t Array::size() const
+	{
+		return isArray() ? reinterpret_cast<const detail::ArrayNode*>(m_val)->entries : 0;
+	}
+
+	inline size_t Object::size() const
+	{
+		return isObject() ? reinterpret_cast<const detail::ObjectNode*>(m_val)->size : 0;
+	}
+}